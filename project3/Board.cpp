@@ -1,8 +1,12 @@
 #include "Board.h"
 #include "Game.h"
+#include "bitboard.h"
 #include "globals.h"
 #include "utility.h"
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <vector>
 
 using namespace std;
 
@@ -21,53 +25,46 @@ public:
 private:
   const Game &m_game;
 
-  struct PositionData {
-    int type_id;
-    bool attacked;
-    bool blocked;
-  };
+  // Placing and removing ships are set operations on these. A ship's cells
+  // are in `m_ship_cells` while it is placed, and `m_occupied` is the union
+  // of them.
+  Bitboard m_occupied;
+  Bitboard m_attacked;
+  Bitboard m_blocked;
+  std::vector<Bitboard> m_ship_cells; // Indexed by ship ID
 
-  struct ShipData {
-    std::vector<Point> positions;
-    bool placed;
-    bool destroyed;
-  };
+  // Which ship is on each cell, or -1 for water, so that a hit does not have
+  // to search the ships
+  signed char m_ship_at[Bitboard::NUM_CELLS];
 
-  std::vector<std::vector<PositionData>> board_data;
-  std::vector<ShipData>
-      ships_data; // Each index should correspond with a ship from `Game::ships`
+  // Unattacked cells of each placed ship, and how many placed ships still
+  // have any, kept up to date by placeShip, unplaceShip and attack so that a
+  // turn never has to look at the ships' cells
+  std::vector<int> m_segments_left; // Indexed by ship ID
+  int m_ships_left;
 
-  char status(PositionData position, bool shots_only) const;
-  PositionData &pos(Point point);
+  int m_ships_placed;
+
+  bool fits(Point topOrLeft, int length, Direction dir) const;
+  char status(Point point, bool shots_only) const;
 };
 
 BoardImpl::BoardImpl(const Game &g)
-    : m_game{g}, board_data{static_cast<size_t>(m_game.rows()),
-                            std::vector<PositionData>{
-                                static_cast<size_t>(m_game.cols()),
-                                {-1,       // type_id
-                                 false,    // attacked
-                                 false}}}, // blocked
-      ships_data{static_cast<size_t>(m_game.nShips()),
-                 {std::vector<Point>(), // positions
-                  false,                // placed
-                  false}}               // destroyed
-{}
+    : m_game{g}, m_ship_cells(static_cast<size_t>(m_game.nShips())),
+      m_segments_left(static_cast<size_t>(m_game.nShips()), 0),
+      m_ships_left{0}, m_ships_placed{0} {
+  std::fill(std::begin(m_ship_at), std::end(m_ship_at), -1);
+}
 
 void BoardImpl::clear() {
-  for (std::vector<PositionData> &row : board_data) {
-    for (PositionData &position : row) {
-      position.type_id = -1;
-      position.attacked = false;
-      position.blocked = false;
-    }
-  }
-
-  for (ShipData &ship : ships_data) {
-    ship.positions.clear();
-    ship.placed = false;
-    ship.destroyed = false;
-  }
+  m_occupied = Bitboard{};
+  m_attacked = Bitboard{};
+  m_blocked = Bitboard{};
+  std::fill(m_ship_cells.begin(), m_ship_cells.end(), Bitboard{});
+  std::fill(std::begin(m_ship_at), std::end(m_ship_at), -1);
+  std::fill(m_segments_left.begin(), m_segments_left.end(), 0);
+  m_ships_left = 0;
+  m_ships_placed = 0;
 }
 
 void BoardImpl::block() {
@@ -77,25 +74,20 @@ void BoardImpl::block() {
   while (block_num > 0) {
     const Point random_point =
         Point{randInt(m_game.rows()), randInt(m_game.cols())};
-    PositionData &random_position = pos(random_point);
 
-    if (!random_position.blocked) {
-      random_position.blocked = true;
+    if (!m_blocked.test(random_point)) {
+      m_blocked.set(random_point);
       block_num--;
     }
   }
 }
 
-void BoardImpl::unblock() {
-  for (std::vector<PositionData> &row : board_data) {
-    for (PositionData &position : row) {
-      position.blocked = false;
-    }
-  }
-}
+void BoardImpl::unblock() { m_blocked = Bitboard{}; }
 
-BoardImpl::PositionData &BoardImpl::pos(Point point) {
-  return board_data.at(point.r).at(point.c);
+// Whether a ship of `length` starting at `topOrLeft` stays on the board
+bool BoardImpl::fits(Point topOrLeft, int length, Direction dir) const {
+  return m_game.isValid(topOrLeft) &&
+         m_game.isValid(move_dir(dir, topOrLeft, length - 1));
 }
 
 // Validation checks:
@@ -108,51 +100,38 @@ BoardImpl::PositionData &BoardImpl::pos(Point point) {
 // not yet been unplaced since its most recent placement.
 bool BoardImpl::placeShip(Point topOrLeft, int shipId, Direction dir) {
   // Validation: Check 1
-  if (!(shipId >= 0 && shipId < m_game.nShips())) {
+  if (!valid_ship_id(shipId, m_game.nShips())) {
     return false;
   }
 
   // Validation: Check 5
-  if (ships_data.at(shipId).placed) {
+  Bitboard &ship = m_ship_cells.at(shipId);
+  if (ship.any()) {
     return false;
   }
 
+  // Validation: Check 2
   const int length = m_game.shipLength(shipId);
+  if (!fits(topOrLeft, length, dir)) {
+    return false;
+  }
 
-  for (int i = 0; i < length; i++) {
-    const Point point = move_dir(dir, topOrLeft, i);
-
-    // Validation: Check 2
-    if (!m_game.isValid(point)) {
-      return false;
-    }
-
-    const PositionData position = pos(point);
-
-    // Validation: Check 3
-    if (position.type_id >= 0) {
-      return false;
-    }
-
-    // Validation: Check 4
-    if (position.blocked) {
-      return false;
-    }
+  // Validation: Checks 3 and 4
+  const Bitboard cells = Bitboard::ship(topOrLeft, length, dir);
+  if (cells.intersects(m_occupied | m_blocked)) {
+    return false;
   }
 
   // Ship placement
-  ShipData &ship = ships_data.at(shipId);
+  ship = cells;
+  m_occupied |= cells;
   for (int i = 0; i < length; i++) {
-    const Point point = move_dir(dir, topOrLeft, i);
-
-    PositionData &position = pos(point);
-
-    position.type_id = shipId;
-    ship.positions.push_back(point);
+    m_ship_at[Bitboard::index(move_dir(dir, topOrLeft, i))] =
+        static_cast<signed char>(shipId);
   }
-
-  ship.placed = true;
-  assert(ship.positions.size() == length);
+  m_segments_left[shipId] = cells.without(m_attacked).count();
+  m_ships_left += m_segments_left[shipId] > 0 ? 1 : 0;
+  m_ships_placed++;
   return true;
 }
 
@@ -172,48 +151,45 @@ bool BoardImpl::unplaceShip(Point topOrLeft, int shipId, Direction dir) {
     return false;
   }
 
-  ShipData &ship_data = ships_data.at(shipId);
-
-  // Validation
-  for (int i = 0; i < ship_data.positions.size(); i++) {
-    const Point current = move_dir(dir, topOrLeft, i);
-    const Point ship_point = ship_data.positions.at(i);
-
-    // Invalid locations
-    if (!equal(current, ship_point)) {
-      return false;
-    }
+  // Invalid locations, including a ship that is not on the board at all
+  Bitboard &ship = m_ship_cells.at(shipId);
+  const int length = m_game.shipLength(shipId);
+  if (ship.none() || !fits(topOrLeft, length, dir) ||
+      ship != Bitboard::ship(topOrLeft, length, dir)) {
+    return false;
   }
 
   // Replace ship with water on the board
-  for (Point point : ship_data.positions) {
-    PositionData &position = pos(point);
-    position.type_id = -1;
-    position.attacked = false;
+  m_occupied = m_occupied.without(ship);
+  m_attacked = m_attacked.without(ship);
+  for (int i = 0; i < length; i++) {
+    m_ship_at[Bitboard::index(move_dir(dir, topOrLeft, i))] = -1;
   }
-
-  // Reset `positions`
-  ship_data.positions.clear();
-  ship_data.placed = false;
-
+  ship = Bitboard{};
+  m_ships_left -= m_segments_left[shipId] > 0 ? 1 : 0;
+  m_segments_left[shipId] = 0;
+  m_ships_placed--;
   return true;
 }
 
-char BoardImpl::status(PositionData position, bool shots_only) const {
+char BoardImpl::status(Point point, bool shots_only) const {
   const char WATER = '.';
   const char DAMAGED = 'X';
   const char MISSED = 'o';
 
-  if (position.type_id == -1) {
-    return position.attacked ? MISSED : WATER;
+  const int type_id = m_ship_at[Bitboard::index(point)];
+  const bool attacked = m_attacked.test(point);
+
+  if (type_id == -1) {
+    return attacked ? MISSED : WATER;
   }
 
   if (shots_only) {
-    return position.attacked ? DAMAGED : WATER;
+    return attacked ? DAMAGED : WATER;
   }
 
-  const char symbol = m_game.shipSymbol(position.type_id);
-  return position.attacked ? DAMAGED : symbol;
+  const char symbol = m_game.shipSymbol(type_id);
+  return attacked ? DAMAGED : symbol;
 }
 
 void BoardImpl::display(bool shotsOnly) const {
@@ -245,10 +221,8 @@ void BoardImpl::display(bool shotsOnly) const {
   for (int i = 0; i < m_game.rows(); i++) {
     std::cout << i << " ";
 
-    const std::vector<PositionData> row = board_data.at(i);
-
-    for (PositionData position : row) {
-      std::cout << status(position, shotsOnly);
+    for (int j = 0; j < m_game.cols(); j++) {
+      std::cout << status(Point{i, j}, shotsOnly);
     }
 
     std::cout << "\n";
@@ -275,53 +249,35 @@ bool BoardImpl::attack(Point p, bool &shotHit, bool &shipDestroyed,
     return false;
   }
 
-  PositionData &position = pos(p);
-
   // Validation: Attack on previously attacked location
-  if (position.attacked) {
+  if (m_attacked.test(p)) {
     return false;
   }
 
-  position.attacked = true;
-  if (position.type_id == -1) {
+  m_attacked.set(p);
+  const int type_id = m_ship_at[Bitboard::index(p)];
+  if (type_id == -1) {
     // Hit water
     shotHit = false;
     shipDestroyed = false;
     shipId = -1;
   } else {
-    // Hit a ship
+    // Hit a ship, which is destroyed once none of its cells is unattacked
     shotHit = true;
-
-    shipDestroyed = true; // Start by assuming the ship is destroyed
-    ShipData &ship_data = ships_data.at(position.type_id);
-
-    ship_data.destroyed = true;
-    for (Point ship_point : ship_data.positions) {
-      const PositionData ship_pos = pos(ship_point);
-
-      if (!ship_pos.attacked) {
-        shipDestroyed = false; // Assumption is incorrect
-        ship_data.destroyed = false;
-      }
-    }
+    shipDestroyed = --m_segments_left[type_id] == 0;
 
     if (shipDestroyed) {
-      shipId = position.type_id;
+      shipId = type_id;
+      m_ships_left--;
     }
   }
 
   return true;
 }
 
+// Every ship is on the board and every cell of every ship has been attacked
 bool BoardImpl::allShipsDestroyed() const {
-  // NOLINTNEXTLINE(readability-use-anyofallof)
-  for (const ShipData &ship_data : ships_data) {
-    if (!ship_data.destroyed) {
-      return false;
-    }
-  }
-
-  return true;
+  return m_ships_placed == m_game.nShips() && m_ships_left == 0;
 }
 
 //******************** Board functions ********************************
@@ -25,6 +25,7 @@ public:
   string shipName(int shipId) const;
   static Player *play(Player *p1, Player *p2, Board &b1, Board &b2,
                       bool shouldPause);
+  GameResult simulate(Player *p1, Player *p2, Board &b1, Board &b2) const;
 
 private:
   int m_rows;
@@ -166,6 +167,53 @@ Player *GameImpl::play(Player *p1, Player *p2, Board &b1, Board &b2,
   return winner;
 }
 
+// The same game as `play()`, minus the output. Only the board just attacked
+// can have lost its last ship, so that is the only one checked each turn.
+GameResult GameImpl::simulate(Player *p1, Player *p2, Board &b1,
+                              Board &b2) const {
+  GameResult result{nullptr, 0, {0, 0}, {0, 0}, {}};
+  result.sinkTurn[0].assign(ships.size(), -1);
+  result.sinkTurn[1].assign(ships.size(), -1);
+
+  if (!p1->placeShips(b1) || !p2->placeShips(b2)) {
+    return result;
+  }
+
+  Player *players[2] = {p1, p2};
+  Board *boards[2] = {&b1, &b2};
+  int attacker = 0;
+
+  while (true) {
+    const int defender = 1 - attacker;
+    result.turns++;
+
+    AttackData attack{Point{-1, -1}, false, false, false, -1};
+    attack.point = players[attacker]->recommendAttack();
+    attack.valid = boards[defender]->attack(attack.point, attack.hit_ship,
+                                            attack.destroyed_ship,
+                                            attack.ship_id);
+
+    players[attacker]->recordAttackResult(attack.point, attack.valid,
+                                          attack.hit_ship,
+                                          attack.destroyed_ship, attack.ship_id);
+    players[defender]->recordAttackByOpponent(attack.point);
+
+    result.shots[attacker]++;
+    if (attack.hit_ship) {
+      result.hits[attacker]++;
+    }
+    if (attack.destroyed_ship) {
+      result.sinkTurn[attacker].at(attack.ship_id) = result.turns;
+      if (boards[defender]->allShipsDestroyed()) {
+        result.winner = players[attacker];
+        return result;
+      }
+    }
+
+    attacker = defender;
+  }
+}
+
 //******************** Game functions *******************************
 
 // These functions for the most part simply delegate to GameImpl's functions.
@@ -255,3 +303,12 @@ Player *Game::play(Player *p1, Player *p2, bool shouldPause) {
   Board b2(*this);
   return m_impl->play(p1, p2, b1, b2, shouldPause);
 }
+
+GameResult Game::simulate(Player *p1, Player *p2) {
+  if (p1 == nullptr || p2 == nullptr || nShips() == 0) {
+    return GameResult{nullptr, 0, {0, 0}, {0, 0}, {}};
+  }
+  Board b1(*this);
+  Board b2(*this);
+  return m_impl->simulate(p1, p2, b1, b2);
+}
@@ -3,11 +3,25 @@
 
 #include <cassert>
 #include <string>
+#include <vector>
 
 class Point;
 class Player;
 class GameImpl;
 
+// What happened in a game played by Game::simulate.  Index 0 of each array is
+// the first player passed to simulate, index 1 the second.  Turns count both
+// players' attacks, starting from 1.
+struct GameResult {
+  Player *winner; // nullptr if a player could not place their ships
+  int turns;
+  int shots[2];
+  int hits[2];
+  // sinkTurn[p][shipId] is the turn on which player p sank the opponent's
+  // ship, or -1 if it was never sunk
+  std::vector<int> sinkTurn[2];
+};
+
 class Game {
 public:
   Game(int nRows, int nCols);
@@ -22,6 +36,8 @@ public:
   char shipSymbol(int shipId) const;
   std::string shipName(int shipId) const;
   Player *play(Player *p1, Player *p2, bool shouldPause = true);
+  // Play a game without any output or pauses, for evaluating players in bulk
+  GameResult simulate(Player *p1, Player *p2);
   // We prevent a Game object from being copied or assigned
   Game(const Game &) = delete;
   Game &operator=(const Game &) = delete;
@@ -1,8 +1,11 @@
 #include "Player.h"
 #include "Board.h"
 #include "Game.h"
+#include "bitboard.h"
 #include "globals.h"
+#include "placement.h"
 #include "utility.h"
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -195,7 +198,6 @@ public:
   virtual void recordAttackByOpponent(Point p);
 
 private:
-  bool recursively_place(Board &b, int ship_id);
   Point random_attack();
   Point cross_pattern_attack();
   bool was_attacked(Point candidate);
@@ -213,52 +215,16 @@ MediocrePlayer::MediocrePlayer(std::string name, const Game &g)
     : Player{name, g}, attacks{static_cast<size_t>(game().rows()),
                                std::vector<bool>(game().cols(), false)} {}
 
-// NOLINTNEXTLINE(misc-no-recursion)
-bool MediocrePlayer::recursively_place(Board &b, int ship_id) {
-  // All ships placed
-  if (ship_id >= game().nShips()) {
-    return true;
-  }
-
-  for (int i = 0; i < game().rows(); i++) {
-    for (int j = 0; j < game().cols(); j++) {
-      const Point current{i, j};
-      if (b.placeShip(current, ship_id, Direction::HORIZONTAL)) {
-        bool placed_all = recursively_place(b, ship_id + 1);
-
-        if (placed_all) {
-          return true;
-        }
-
-        // Backtrack if impossible to place current ship
-        b.unplaceShip(current, ship_id, Direction::HORIZONTAL);
-      }
-      if (b.placeShip(current, ship_id, Direction::VERTICAL)) {
-        bool placed_all = recursively_place(b, ship_id + 1);
-
-        if (placed_all) {
-          return true;
-        }
-
-        // Backtrack if impossible to place current ship
-        b.unplaceShip(current, ship_id, Direction::VERTICAL);
-      }
-    }
-  }
-
-  // Impossible to place all ships
-  return false;
-}
-
 // Remember that Mediocre::placeShips(Board& b) must start by calling
-// b.block(), and must call b.unblock() just before returning.
+// b.block(), and must call b.unblock() just before returning. Each attempt
+// does bounded work, and a retry blocks a different half of the board.
 bool MediocrePlayer::placeShips(Board &b) {
   const int MAX_RETRIES = 50;
 
   for (int i = 0; i < MAX_RETRIES; i++) {
     b.block();
 
-    if (recursively_place(b, 0)) {
+    if (placeShipsRandomly(game(), b)) {
       b.unblock();
       return true;
     }
@@ -359,6 +325,15 @@ void MediocrePlayer::recordAttackByOpponent(Point /* p */) {}
 //  GoodPlayer
 //*********************************************************************
 
+// Define GOOD_PLAYER_TRACE to have GoodPlayer explain every attack it
+// recommends on cerr. It is off so that simulated games stay silent.
+// #define GOOD_PLAYER_TRACE
+#ifdef GOOD_PLAYER_TRACE
+#define GOOD_PLAYER_LOG(message) (std::cerr << message)
+#else
+#define GOOD_PLAYER_LOG(message) ((void)0)
+#endif
+
 // TODO:  You need to replace this with a real class declaration and
 //        implementation.
 class GoodPlayer : public Player {
@@ -371,7 +346,6 @@ public:
   virtual void recordAttackByOpponent(Point p);
 
 private:
-  bool recursively_place(Board &b, int ship_id);
   Point random_checkboard_attack();
   Point find_ship_direction();
   bool was_attacked(Point candidate);
@@ -396,50 +370,13 @@ GoodPlayer::GoodPlayer(std::string name, const Game &g)
     : Player(name, g), attacks{static_cast<size_t>(game().rows()),
                                std::vector<bool>(game().cols(), false)} {}
 
-// NOLINTNEXTLINE(misc-no-recursion)
-bool GoodPlayer::recursively_place(Board &b, int ship_id) {
-  // All ships placed
-  if (ship_id >= game().nShips()) {
-    return true;
-  }
-
-  for (int i = 0; i < game().rows(); i++) {
-    for (int j = 0; j < game().cols(); j++) {
-      const Point current{i, j};
-      if (b.placeShip(current, ship_id, Direction::HORIZONTAL)) {
-        bool placed_all = recursively_place(b, ship_id + 1);
-
-        if (placed_all) {
-          return true;
-        }
-
-        // Backtrack if impossible to place current ship
-        b.unplaceShip(current, ship_id, Direction::HORIZONTAL);
-      }
-      if (b.placeShip(current, ship_id, Direction::VERTICAL)) {
-        bool placed_all = recursively_place(b, ship_id + 1);
-
-        if (placed_all) {
-          return true;
-        }
-
-        // Backtrack if impossible to place current ship
-        b.unplaceShip(current, ship_id, Direction::VERTICAL);
-      }
-    }
-  }
-
-  // Impossible to place all ships
-  return false;
-}
-
 bool GoodPlayer::placeShips(Board &b) {
   const int MAX_RETRIES = 50;
 
   for (int i = 0; i < MAX_RETRIES; i++) {
     b.block();
 
-    if (recursively_place(b, 0)) {
+    if (placeShipsRandomly(game(), b)) {
       b.unblock();
       return true;
     }
@@ -485,9 +422,11 @@ Point GoodPlayer::random_checkboard_attack() {
   }
 
   prev_attack = RANDOM;
-  std::cerr << "Below attack uses random_checkboard_attack() 🥵" << std::endl;
-  std::cerr << "\tRecommended point is (" << recommended.r << ","
-            << recommended.c << ")" << std::endl;
+  GOOD_PLAYER_LOG("Below attack uses random_checkboard_attack() 🥵"
+                  << std::endl);
+  GOOD_PLAYER_LOG("\tRecommended point is (" << recommended.r << ","
+                                              << recommended.c << ")"
+                                              << std::endl);
   return recommended;
 }
 
@@ -507,10 +446,10 @@ Point GoodPlayer::find_ship_direction() {
 
   for (Point offset : cardinal_offsets) {
     Point candidate = add_points(initial_hit, offset);
-    std::cerr << "Ship direction candidate is (" << candidate.r << ","
-              << candidate.c << "): " << std::boolalpha
-              << game().isValid(candidate) << ", " << !was_attacked(candidate)
-              << std::endl;
+    GOOD_PLAYER_LOG("Ship direction candidate is ("
+                    << candidate.r << "," << candidate.c
+                    << "): " << std::boolalpha << game().isValid(candidate)
+                    << ", " << !was_attacked(candidate) << std::endl);
 
     if (game().isValid(candidate) && !was_attacked(candidate)) {
       // Found a valid point adjacent to the hit ship segment
@@ -522,16 +461,17 @@ Point GoodPlayer::find_ship_direction() {
 
   // None of the four adjacent points are valid
   if (equal(recommended, Point{-1, -1})) {
-    std::cerr
-        << "find_ship_direction() -> random_checkboard_attack(), offset of ("
-        << repeated_offset.r << "," << repeated_offset.c << ")" << std::endl;
+    GOOD_PLAYER_LOG(
+        "find_ship_direction() -> random_checkboard_attack(), offset of ("
+        << repeated_offset.r << "," << repeated_offset.c << ")" << std::endl);
     return random_checkboard_attack();
   }
 
   prev_attack = FIND_SHIP_DIRECTION;
-  std::cerr << "Below attack uses find_ship_direction() 😭" << std::endl;
-  std::cerr << "\tUses the offset (" << repeated_offset.r << ", "
-            << repeated_offset.c << ")" << std::endl;
+  GOOD_PLAYER_LOG("Below attack uses find_ship_direction() 😭" << std::endl);
+  GOOD_PLAYER_LOG("\tUses the offset (" << repeated_offset.r << ", "
+                                         << repeated_offset.c << ")"
+                                         << std::endl);
   return recommended;
 }
 
@@ -553,24 +493,26 @@ Point GoodPlayer::destroy_ship() {
     // `destroy_ship()` will switch to a different strategy (rather than being
     // terminated when a ship is destroyed, since that would never occur)
     if (!game().isValid(recommended) || was_attacked(recommended)) {
-      std::cerr << "destroy_ship() -> random_attack(), offset of ("
-                << repeated_offset.r << "," << repeated_offset.c << ")"
-                << std::endl;
+      GOOD_PLAYER_LOG("destroy_ship() -> random_attack(), offset of ("
+                      << repeated_offset.r << "," << repeated_offset.c << ")"
+                      << std::endl);
       return random_checkboard_attack();
     }
   }
 
   prev_attack = DESTROY_SHIP;
-  std::cerr << "Below attack uses destroy_ship() 🤡\n";
-  std::cerr << "\tUses the repeated offset (" << repeated_offset.r << ", "
-            << repeated_offset.c << ")" << std::endl;
+  GOOD_PLAYER_LOG("Below attack uses destroy_ship() 🤡\n");
+  GOOD_PLAYER_LOG("\tUses the repeated offset ("
+                  << repeated_offset.r << ", " << repeated_offset.c << ")"
+                  << std::endl);
   return recommended;
 }
 
 Point GoodPlayer::recommendAttack() {
-  std::cerr << "Initial hit is (" << initial_hit.r << "," << initial_hit.c
-            << "), last hit is (" << last_hit.r << "," << last_hit.c << ")"
-            << std::endl;
+  GOOD_PLAYER_LOG("Initial hit is (" << initial_hit.r << "," << initial_hit.c
+                                      << "), last hit is (" << last_hit.r
+                                      << "," << last_hit.c << ")"
+                                      << std::endl);
   Point recommended{-1, -1};
 
   switch (prev_attack) {
@@ -631,6 +573,205 @@ void GoodPlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
 
 void GoodPlayer::recordAttackByOpponent(Point /* p */) {}
 
+//*********************************************************************
+//  DensityPlayer
+//*********************************************************************
+
+// Each turn, counts for every cell how many ways the ships it hasn't sunk yet
+// could lie across it, given its hits, misses and sinks, and fires at the
+// cell with the most. Every placement of every ship length starts out as a
+// Bitboard in a list for that length; a miss or a sink drops the placements
+// it rules out, so the lists only hold placements still possible. Ships of
+// the same length share a list, counted once and weighted by how many of
+// them are left.
+//
+// While it has hits that no sunk ship accounts for, it only counts the
+// placements that cover at least one of them, weighting each by how many it
+// covers, so it finishes off a ship it has found before hunting for another.
+class DensityPlayer : public Player {
+public:
+  DensityPlayer(std::string name, const Game &g);
+  virtual bool placeShips(Board &b);
+  virtual Point recommendAttack();
+  virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                  bool shipDestroyed, int shipId);
+  virtual void recordAttackByOpponent(Point p);
+
+private:
+  // Adds each placement's weight to the cells it covers, returning whether
+  // any placement counted
+  bool count_placements(bool targeting, int counts[]) const;
+  void record_sink(Point p, int ship_id);
+  void rule_out(const Bitboard &cells);
+
+  struct ShipLength {
+    int unsunk{0}; // Ships of this length still afloat
+    std::vector<Bitboard> placements;
+  };
+  std::vector<ShipLength> lengths; // Indexed by ship length
+  Bitboard attacked;
+  Bitboard open_hits; // Hits not yet accounted for by a sunk ship
+};
+
+DensityPlayer::DensityPlayer(std::string name, const Game &g)
+    // NOLINTNEXTLINE(performance-unnecessary-value-param)
+    : Player{name, g} {
+  int longest = 0;
+  for (int ship_id = 0; ship_id < game().nShips(); ship_id++) {
+    longest = std::max(longest, game().shipLength(ship_id));
+  }
+  lengths.resize(static_cast<size_t>(longest) + 1);
+
+  for (int ship_id = 0; ship_id < game().nShips(); ship_id++) {
+    const int length = game().shipLength(ship_id);
+    ShipLength &same_length = lengths.at(length);
+    if (same_length.unsunk++ > 0) {
+      continue;
+    }
+    std::vector<Bitboard> &masks = same_length.placements;
+    masks.reserve(static_cast<size_t>(2 * game().rows() * game().cols()));
+    for (int r = 0; r < game().rows(); r++) {
+      for (int c = 0; c < game().cols(); c++) {
+        if (c + length <= game().cols()) {
+          masks.push_back(Bitboard::ship(Point{r, c}, length, HORIZONTAL));
+        }
+        if (length > 1 && r + length <= game().rows()) {
+          masks.push_back(Bitboard::ship(Point{r, c}, length, VERTICAL));
+        }
+      }
+    }
+  }
+}
+
+// Any layout is as likely as any other, so there is no pattern to exploit
+bool DensityPlayer::placeShips(Board &b) {
+  return placeShipsRandomly(game(), b);
+}
+
+bool DensityPlayer::count_placements(bool targeting, int counts[]) const {
+  bool counted = false;
+
+  for (const ShipLength &same_length : lengths) {
+    if (same_length.unsunk == 0) {
+      continue;
+    }
+    for (const Bitboard &mask : same_length.placements) {
+      int weight = same_length.unsunk;
+      if (targeting) {
+        weight *= (mask & open_hits).count();
+        if (weight == 0) {
+          continue;
+        }
+      }
+      counted = true;
+      for (Bitboard rest = mask; rest.any();) {
+        const int cell = rest.lowest();
+        counts[cell] += weight;
+        rest.reset(cell);
+      }
+    }
+  }
+
+  return counted;
+}
+
+Point DensityPlayer::recommendAttack() {
+  int counts[Bitboard::NUM_CELLS] = {};
+
+  // Finish off the ships already found, if any placement can explain them
+  if (open_hits.none() || !count_placements(true, counts)) {
+    count_placements(false, counts);
+  }
+
+  // Fire at the cell with the highest count, choosing uniformly among ties.
+  // If nothing counted, every unattacked cell ties at 0.
+  Point recommended{-1, -1};
+  int best = -1;
+  int ties = 0;
+  for (int r = 0; r < game().rows(); r++) {
+    for (int c = 0; c < game().cols(); c++) {
+      const Point cell{r, c};
+      if (attacked.test(cell)) {
+        continue;
+      }
+      const int count = counts[Bitboard::index(cell)];
+      if (count > best) {
+        best = count;
+        ties = 1;
+        recommended = cell;
+      } else if (count == best && randInt(++ties) == 0) {
+        recommended = cell;
+      }
+    }
+  }
+
+  return recommended;
+}
+
+// Works out which hits belonged to the ship just sunk: the first placement of
+// its length through `p` made only of open hits. If the hits could belong to
+// more than one placement, this may guess wrong; the hits it leaves open then
+// get no placements and are ignored.
+void DensityPlayer::record_sink(Point p, int ship_id) {
+  ShipLength &same_length = lengths.at(game().shipLength(ship_id));
+  same_length.unsunk--;
+
+  Bitboard sunk_cells;
+  for (const Bitboard &mask : same_length.placements) {
+    if (mask.test(p) && (mask & open_hits) == mask) {
+      sunk_cells = mask;
+      break;
+    }
+  }
+  // No placement fits only if an earlier guess was wrong
+  if (sunk_cells.none()) {
+    sunk_cells.set(p);
+  }
+
+  open_hits = open_hits.without(sunk_cells);
+  rule_out(sunk_cells);
+}
+
+// Drops every placement that covers any of `cells`
+void DensityPlayer::rule_out(const Bitboard &cells) {
+  for (ShipLength &same_length : lengths) {
+    std::vector<Bitboard> &masks = same_length.placements;
+    if (same_length.unsunk == 0) {
+      masks.clear();
+      continue;
+    }
+    masks.erase(std::remove_if(masks.begin(), masks.end(),
+                               [&cells](const Bitboard &mask) {
+                                 return mask.intersects(cells);
+                               }),
+                masks.end());
+  }
+}
+
+void DensityPlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                       bool shipDestroyed, int shipId) {
+  if (!validShot) {
+    throw std::invalid_argument("Invalid shot at (" + std::to_string(p.r) +
+                                "," + std::to_string(p.c) +
+                                "), which `DensityPlayer` should not allow.");
+  }
+
+  attacked.set(p);
+  if (!shotHit) {
+    Bitboard miss;
+    miss.set(p);
+    rule_out(miss);
+    return;
+  }
+
+  open_hits.set(p);
+  if (shipDestroyed) {
+    record_sink(p, shipId);
+  }
+}
+
+void DensityPlayer::recordAttackByOpponent(Point /* p */) {}
+
 //*********************************************************************
 //  createPlayer
 //*********************************************************************
@@ -639,7 +780,7 @@ void GoodPlayer::recordAttackByOpponent(Point /* p */) {}
 Player *createPlayer(string type, // NOLINT(performance-unnecessary-value-param)
                      string nm,   // NOLINT(performance-unnecessary-value-param)
                      const Game &g) {
-  static string types[] = {"human", "awful", "mediocre", "good"};
+  static string types[] = {"human", "awful", "mediocre", "good", "density"};
 
   int pos;
   for (pos = 0; pos != sizeof(types) / sizeof(types[0]) && type != types[pos];
@@ -655,6 +796,8 @@ Player *createPlayer(string type, // NOLINT(performance-unnecessary-value-param)
     return new MediocrePlayer(nm, g);
   case 3:
     return new GoodPlayer(nm, g);
+  case 4:
+    return new DensityPlayer(nm, g);
   default:
     return nullptr;
   }
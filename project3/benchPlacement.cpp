@@ -0,0 +1,204 @@
+// Ship placement benchmark
+//
+// Usage:  benchPlacement [--option=value ...]
+//
+//   --seed=N       random seed (1)
+//   --layouts=N    layouts to ask each method for, per fleet (1000)
+//   --budget=N     most placeShip calls the old search may make per attempt
+//                  before it counts as stuck (100000)
+//
+// Build with Board.cpp, Game.cpp, placement.cpp and utility.cpp in place of
+// main.cpp.  For each of several fleets, asks for layouts three ways:
+//
+//   solver        PlacementSolver on an empty board, as DensityPlayer places
+//   solver+block  b.block() then placeShipsRandomly, up to 50 attempts, as
+//                 MediocrePlayer and GoodPlayer place
+//   old+block     b.block() then the exhaustive backtracking those players
+//                 used before, up to 50 attempts
+//
+// and prints the time per layout, how often each found one, and for the
+// solver how many layouts were uniform draws and its average work.
+
+#include "Board.h"
+#include "Game.h"
+#include "globals.h"
+#include "placement.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const int MAX_RETRIES = 50;
+
+struct Fleet {
+  string name;
+  int rows;
+  int cols;
+  vector<int> lengths;
+};
+
+struct Outcome {
+  int found = 0;
+  int sampled = 0;
+  long long samples = 0;
+  long long nodes = 0;
+  int stuck = 0;
+  double ms = 0;
+};
+
+bool parseOption(const string &arg, const string &name, string &value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+void addFleet(Game &g, const Fleet &fleet) {
+  const string symbols = "ABCDEFGHIJKLMNPQRSTUVWYZ"; // Not X, which is a hit
+  for (size_t k = 0; k < fleet.lengths.size(); k++) {
+    g.addShip(fleet.lengths[k], symbols[k], "ship " + to_string(k));
+  }
+}
+
+// The search MediocrePlayer and GoodPlayer used before PlacementSolver: every
+// cell and both directions for each ship in turn, backtracking on failure.
+// Gives up once it has made `budget` calls to placeShip.
+// NOLINTNEXTLINE(misc-no-recursion)
+bool oldPlace(const Game &g, Board &b, int shipId, long long &budget) {
+  if (shipId >= g.nShips()) {
+    return true;
+  }
+  for (int r = 0; r < g.rows(); r++) {
+    for (int c = 0; c < g.cols(); c++) {
+      for (Direction dir : {HORIZONTAL, VERTICAL}) {
+        if (--budget < 0) {
+          return false;
+        }
+        if (b.placeShip(Point(r, c), shipId, dir)) {
+          if (oldPlace(g, b, shipId + 1, budget)) {
+            return true;
+          }
+          b.unplaceShip(Point(r, c), shipId, dir);
+        }
+      }
+    }
+  }
+  return false;
+}
+
+double elapsedMs(chrono::steady_clock::time_point begin) {
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - begin)
+      .count();
+}
+
+Outcome runSolver(const Game &g, int layouts) {
+  Outcome outcome;
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  PlacementSolver solver = PlacementSolver::forGame(g);
+  vector<ShipPlacement> layout;
+  for (int k = 0; k < layouts; k++) {
+    if (solver.solve(layout)) {
+      outcome.found++;
+    }
+    outcome.sampled += solver.stats().sampled ? 1 : 0;
+    outcome.samples += solver.stats().samples;
+    outcome.nodes += solver.stats().nodes;
+  }
+  outcome.ms = elapsedMs(begin);
+  return outcome;
+}
+
+Outcome runBlocked(const Game &g, int layouts, bool old, long long budget) {
+  Outcome outcome;
+  Board b(g);
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  for (int k = 0; k < layouts; k++) {
+    bool placed = false;
+    for (int i = 0; i < MAX_RETRIES && !placed; i++) {
+      b.block();
+      if (old) {
+        long long left = budget;
+        placed = oldPlace(g, b, 0, left);
+        outcome.stuck += left < 0 ? 1 : 0;
+      } else {
+        placed = placeShipsRandomly(g, b);
+      }
+      b.clear();
+    }
+    outcome.found += placed ? 1 : 0;
+  }
+  outcome.ms = elapsedMs(begin);
+  return outcome;
+}
+
+void printOutcome(const string &method, const Outcome &outcome, int layouts,
+                  bool solverStats) {
+  cout << "  " << left << setw(14) << method << right << fixed
+       << setprecision(1) << setw(12) << outcome.ms * 1000 / layouts
+       << setw(9) << 100.0 * outcome.found / layouts << "%";
+  if (solverStats) {
+    cout << setw(9) << 100.0 * outcome.sampled / layouts << "%" << setw(10)
+         << static_cast<double>(outcome.samples) / layouts << setw(10)
+         << static_cast<double>(outcome.nodes) / layouts;
+  } else if (outcome.stuck > 0) {
+    cout << "   (" << outcome.stuck << " attempts hit the budget)";
+  }
+  cout << endl;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long long seed = 1;
+  int layouts = 1000;
+  long long budget = 100000;
+
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    string value;
+    if (parseOption(arg, "seed", value)) {
+      seed = strtoull(value.c_str(), nullptr, 10);
+    } else if (parseOption(arg, "layouts", value)) {
+      layouts = atoi(value.c_str());
+    } else if (parseOption(arg, "budget", value)) {
+      budget = atoll(value.c_str());
+    } else {
+      cerr << "Unknown option " << arg << endl;
+      return 2;
+    }
+  }
+  if (layouts < 1) {
+    layouts = 1;
+  }
+  seedRandom(seed);
+
+  const vector<Fleet> fleets = {
+      {"standard 10x10", 10, 10, {5, 4, 3, 3, 2}},
+      {"12 patrol boats 10x10", 10, 10, vector<int>(12, 2)},
+      {"long ships 10x10", 10, 10, {9, 8, 7, 6, 5}},
+      {"lengths 1-9 10x10", 10, 10, {1, 2, 3, 4, 5, 6, 7, 8, 9}},
+      {"crowded 6x6", 6, 6, {4, 4, 3, 3, 3, 2, 2}},
+      {"tiny 3x3", 3, 3, {3, 2, 2}},
+  };
+
+  cout << "Times are per layout asked for; uniform is the share of layouts"
+       << " drawn uniformly" << endl;
+  for (const Fleet &fleet : fleets) {
+    Game g(fleet.rows, fleet.cols);
+    addFleet(g, fleet);
+    cout << endl
+         << fleet.name << endl
+         << "  " << left << setw(14) << "Method" << right << setw(12)
+         << "us/layout" << setw(10) << "Found" << setw(10) << "Uniform"
+         << setw(10) << "Samples" << setw(10) << "Nodes" << endl;
+    printOutcome("solver", runSolver(g, layouts), layouts, true);
+    printOutcome("solver+block", runBlocked(g, layouts, false, budget),
+                 layouts, false);
+    printOutcome("old+block", runBlocked(g, layouts, true, budget), layouts,
+                 false);
+  }
+}
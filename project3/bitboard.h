@@ -0,0 +1,127 @@
+#ifndef BITBOARD_INCLUDED
+#define BITBOARD_INCLUDED
+
+#include "globals.h"
+#include <cstdint>
+
+// A set of cells on a board of up to MAXROWS x MAXCOLS, one bit per cell.
+// Cell (r,c) is bit r * MAXCOLS + c, whatever the size of the actual game, so
+// a 10x10 board fits in two 64-bit words and a set operation on a whole
+// board is two word operations.
+class Bitboard {
+public:
+  static const int NUM_CELLS = MAXROWS * MAXCOLS;
+
+  Bitboard() : m_words{0, 0} {}
+
+  static int index(Point p) { return p.r * MAXCOLS + p.c; }
+  static Point point(int index) {
+    return Point{index / MAXCOLS, index % MAXCOLS};
+  }
+
+  // The cells a ship of `length` covers starting at `topOrLeft`. The caller
+  // makes sure they are all on the board.
+  static Bitboard ship(Point topOrLeft, int length, Direction dir) {
+    Bitboard result;
+    const int step = dir == HORIZONTAL ? 1 : MAXCOLS;
+    for (int i = 0, cell = index(topOrLeft); i < length; i++, cell += step) {
+      result.set(cell);
+    }
+    return result;
+  }
+
+  bool test(int index) const {
+    return ((m_words[index >> 6] >> (index & 63)) & 1) != 0;
+  }
+  bool test(Point p) const { return test(index(p)); }
+  void set(int index) { m_words[index >> 6] |= uint64_t{1} << (index & 63); }
+  void set(Point p) { set(index(p)); }
+  void reset(int index) {
+    m_words[index >> 6] &= ~(uint64_t{1} << (index & 63));
+  }
+  void reset(Point p) { reset(index(p)); }
+
+  bool none() const { return (m_words[0] | m_words[1]) == 0; }
+  bool any() const { return !none(); }
+  int count() const { return popcount(m_words[0]) + popcount(m_words[1]); }
+
+  // Index of the lowest cell in the set, or -1 if it is empty
+  int lowest() const {
+    if (m_words[0] != 0) {
+      return trailing_zeros(m_words[0]);
+    }
+    if (m_words[1] != 0) {
+      return 64 + trailing_zeros(m_words[1]);
+    }
+    return -1;
+  }
+
+  bool intersects(const Bitboard &other) const {
+    return ((m_words[0] & other.m_words[0]) |
+            (m_words[1] & other.m_words[1])) != 0;
+  }
+
+  // The cells of this set that are not in `other`
+  Bitboard without(const Bitboard &other) const {
+    return Bitboard{m_words[0] & ~other.m_words[0],
+                    m_words[1] & ~other.m_words[1]};
+  }
+
+  Bitboard operator&(const Bitboard &other) const {
+    return Bitboard{m_words[0] & other.m_words[0],
+                    m_words[1] & other.m_words[1]};
+  }
+  Bitboard operator|(const Bitboard &other) const {
+    return Bitboard{m_words[0] | other.m_words[0],
+                    m_words[1] | other.m_words[1]};
+  }
+  Bitboard &operator&=(const Bitboard &other) {
+    m_words[0] &= other.m_words[0];
+    m_words[1] &= other.m_words[1];
+    return *this;
+  }
+  Bitboard &operator|=(const Bitboard &other) {
+    m_words[0] |= other.m_words[0];
+    m_words[1] |= other.m_words[1];
+    return *this;
+  }
+  bool operator==(const Bitboard &other) const {
+    return m_words[0] == other.m_words[0] && m_words[1] == other.m_words[1];
+  }
+  bool operator!=(const Bitboard &other) const { return !(*this == other); }
+
+private:
+  Bitboard(uint64_t low, uint64_t high) : m_words{low, high} {}
+
+  static int popcount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word != 0; word &= word - 1) {
+      count++;
+    }
+    return count;
+#endif
+  }
+
+  // `word` must not be 0
+  static int trailing_zeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int count = 0;
+    for (; (word & 1) == 0; word >>= 1) {
+      count++;
+    }
+    return count;
+#endif
+  }
+
+  uint64_t m_words[2]; // Cells 0-63, then cells 64 and up
+};
+
+static_assert(Bitboard::NUM_CELLS <= 128,
+              "A Bitboard holds at most 128 cells");
+
+#endif // BITBOARD_INCLUDED
@@ -1,7 +1,7 @@
 #ifndef GLOBALS_INCLUDED
 #define GLOBALS_INCLUDED
 
-#include <random>
+#include "rng.h"
 
 const int MAXROWS = 10;
 const int MAXCOLS = 10;
@@ -17,15 +17,17 @@ public:
   int c; // NOLINT(misc-non-private-member-variables-in-classes)
 };
 
-// Return a uniformly distributed random int from 0 to limit-1
+// Return a uniformly distributed random int from 0 to limit-1. Draws from the
+// calling thread's generator, so games can be simulated on several threads at
+// once; seed it with seedRandom to make them reproducible.
 inline int randInt(int limit) {
-  static std::random_device rd;
-  static std::mt19937 generator(rd());
   if (limit < 1) {
     limit = 1;
   }
-  std::uniform_int_distribution<> distro(0, limit - 1);
-  return distro(generator);
+  return static_cast<int>(threadRng().below(static_cast<uint32_t>(limit)));
 }
 
+// Restart the calling thread's random sequence from `seed`
+inline void seedRandom(uint64_t seed) { threadRng().reseed(seed); }
+
 #endif // GLOBALS_INCLUDED
@@ -2,7 +2,11 @@
 #include "Game.h"
 #include "Player.h"
 #include "globals.h"
+#include "placement.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <string>
 
 using namespace std;
@@ -136,6 +140,8 @@ void board_tests() {
     assert(b.unplaceShip(Point{ship.id, 0}, ship.id, HORIZONTAL));
     std::cerr << "Unplaced ship with id " << ship.id << std::endl;
   }
+  assert(!b.unplaceShip(Point{0, 0}, test_ships.at(0).id,
+                        HORIZONTAL)); // Ship is no longer on the board
   assert(!b.allShipsDestroyed()); // Unplacing ships does not destroy them
   b.display(false);
   std::cerr << "The above board should contain no ships." << std::endl;
@@ -188,6 +194,22 @@ void board_tests() {
   }
   assert(b.allShipsDestroyed());
 
+  // A destroyed ship that is moved is afloat again until it is sunk again
+  const TestShip &longest = test_ships.back();
+  assert(b.unplaceShip(Point{longest.id, 0}, longest.id, HORIZONTAL));
+  assert(!b.allShipsDestroyed());
+  assert(b.placeShip(Point{MAXROWS - 1, 0}, longest.id, HORIZONTAL));
+  assert(!b.allShipsDestroyed());
+  for (int i = 0; i < longest.length; i++) {
+    bool hit = false;
+    bool destroyed = true;
+    int ship_id = -1;
+    assert(b.attack(Point{MAXROWS - 1, i}, hit, destroyed, ship_id));
+    assert(hit);
+    assert(destroyed == (i == longest.length - 1));
+    assert(b.allShipsDestroyed() == destroyed);
+  }
+
   std::cerr << "Passed `Board` test cases 🤩" << std::endl;
 }
 
@@ -326,6 +348,196 @@ void good_player_tests() {
   std::cerr << "Passed good player test cases." << std::endl;
 }
 
+void density_player_tests() {
+  Game g_std{MAXROWS, MAXCOLS};
+  addStandardShips(g_std);
+
+  const int TEST_PLAY = 10000;
+  int density_wins = 0;
+  int density_shots = 0;
+  for (int i = 0; i < TEST_PLAY; i++) {
+    Player *density = createPlayer("density", "test_density", g_std);
+    Player *good = createPlayer("good", "test_good", g_std);
+    const bool density_first = i % 2 == 0;
+
+    const GameResult result = density_first ? g_std.simulate(density, good)
+                                            : g_std.simulate(good, density);
+    if (result.winner == density) {
+      density_wins++;
+      density_shots += result.shots[density_first ? 0 : 1];
+    }
+    delete density;
+    delete good;
+  }
+
+  const double MIN_WIN_RATE = 0.6;
+  const double density_win_rate =
+      density_wins / static_cast<double>(TEST_PLAY);
+
+  std::cout << "Density player won " << density_win_rate * 100
+            << "% of the games against a good player, averaging "
+            << density_shots / static_cast<double>(density_wins)
+            << " shots per win." << std::endl;
+  assert(density_win_rate >= MIN_WIN_RATE);
+
+  // It never needs more shots than there are cells, so it never repeats one
+  Game g_tiny{1, 5};
+  g_tiny.addShip(2, 'P', "patrol boat");
+  g_tiny.addShip(1, 'R', "rowboat");
+  for (int i = 0; i < 100; i++) {
+    Player *first = createPlayer("density", "test_first", g_tiny);
+    Player *second = createPlayer("density", "test_second", g_tiny);
+    const GameResult result = g_tiny.simulate(first, second);
+    assert(result.winner != nullptr);
+    assert(result.shots[0] <= 5 && result.shots[1] <= 5);
+    delete first;
+    delete second;
+  }
+
+  std::cerr << "Passed density player test cases." << std::endl;
+}
+
+// `PlacementSolver` tests
+void placement_tests() {
+  // A 3-ship and a 2-ship fit on a 3x3 board in 36 ways, which should all
+  // come up about equally often
+  Game g_small{3, 3};
+  g_small.addShip(3, 'A', "long");
+  g_small.addShip(2, 'B', "short");
+  PlacementSolver solver = PlacementSolver::forGame(g_small);
+  std::vector<ShipPlacement> layout;
+  std::map<int, int> seen;
+  const int DRAWS = 72000;
+  for (int i = 0; i < DRAWS; i++) {
+    assert(solver.solve(layout));
+    assert(solver.stats().sampled);
+    assert(layout.size() == 2);
+    assert(!layout[0].cells.intersects(layout[1].cells));
+    int key = 0;
+    for (const ShipPlacement &p : layout) {
+      key = key * 1000 + Bitboard::index(p.topOrLeft) * 2 + p.dir;
+    }
+    seen[key]++;
+  }
+  assert(seen.size() == 36);
+  for (const auto &layout_count : seen) {
+    assert(layout_count.second > DRAWS / 36 * 8 / 10);
+    assert(layout_count.second < DRAWS / 36 * 12 / 10);
+  }
+
+  // Ships that cannot help overlapping give up within the bounds: these can
+  // reach enough cells between them, so every draw and then the search fail
+  const ShipPlacement corner{Point{0, 0}, HORIZONTAL,
+                             Bitboard::ship(Point{0, 0}, 2, HORIZONTAL)};
+  const ShipPlacement beside{Point{0, 1}, HORIZONTAL,
+                             Bitboard::ship(Point{0, 1}, 2, HORIZONTAL)};
+  const ShipPlacement below{Point{0, 0}, VERTICAL,
+                            Bitboard::ship(Point{0, 0}, 2, VERTICAL)};
+  PlacementSolver overlapping{{{corner}, {beside, below}}};
+  assert(!overlapping.solve(layout));
+  assert(overlapping.stats().samples == PlacementSolver::MAX_SAMPLES);
+  assert(overlapping.stats().nodes > 0);
+  assert(overlapping.stats().nodes <= PlacementSolver::MAX_NODES);
+
+  // Ships with more cells than they can reach give up without trying
+  PlacementSolver crowded{{{corner}, {corner}}};
+  assert(!crowded.solve(layout));
+  assert(crowded.stats().samples == 0);
+
+  // With half the board blocked, the standard fleet fits about 90% of the
+  // time, and placeShipsRandomly places every ship when it does
+  Game g_std{MAXROWS, MAXCOLS};
+  addStandardShips(g_std);
+  Board b{g_std};
+  int placed = 0;
+  for (int i = 0; i < 100; i++) {
+    b.block();
+    if (placeShipsRandomly(g_std, b)) {
+      placed++;
+      for (int ship_id = 0; ship_id < g_std.nShips(); ship_id++) {
+        assert(!b.placeShip(Point{0, 0}, ship_id, HORIZONTAL));
+      }
+    }
+    b.clear();
+  }
+  assert(placed >= 75);
+
+  std::cerr << "Passed placement test cases." << std::endl;
+}
+
+// `Game::simulate()` tests
+void headless_tests() {
+  Game g_std{MAXROWS, MAXCOLS};
+  addStandardShips(g_std);
+
+  int total_length = 0;
+  for (int s = 0; s < g_std.nShips(); s++) {
+    total_length += g_std.shipLength(s);
+  }
+
+  const int TEST_PLAY = 100000;
+  int good_wins = 0;
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < TEST_PLAY; i++) {
+    Player *mediocre = createPlayer("mediocre", "test_mediocre", g_std);
+    Player *good = createPlayer("good", "test_good", g_std);
+    const bool good_first = i % 2 == 0;
+    const int good_index = good_first ? 0 : 1;
+
+    const GameResult result = good_first ? g_std.simulate(good, mediocre)
+                                         : g_std.simulate(mediocre, good);
+    assert(result.winner == good || result.winner == mediocre);
+    const int winner = result.winner == good ? good_index : 1 - good_index;
+
+    // The winner sank every ship, last of all on the final turn, and the
+    // first player made the extra shot if the game had an odd number of turns
+    assert(result.hits[winner] == total_length);
+    assert(result.shots[0] + result.shots[1] == result.turns);
+    assert(result.shots[0] - result.shots[1] == result.turns % 2);
+    int last_sink = 0;
+    for (int turn : result.sinkTurn[winner]) {
+      assert(turn >= 1 && turn <= result.turns);
+      last_sink = std::max(last_sink, turn);
+    }
+    assert(last_sink == result.turns);
+    assert(result.hits[1 - winner] < total_length);
+
+    if (result.winner == good) {
+      good_wins++;
+    }
+    delete mediocre;
+    delete good;
+  }
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  // The same seed replays the same game
+  GameResult replays[2];
+  bool good_won[2];
+  for (int k = 0; k < 2; k++) {
+    seedRandom(32);
+    Player *mediocre = createPlayer("mediocre", "test_mediocre", g_std);
+    Player *good = createPlayer("good", "test_good", g_std);
+    replays[k] = g_std.simulate(good, mediocre);
+    good_won[k] = replays[k].winner == good;
+    delete mediocre;
+    delete good;
+  }
+  assert(good_won[0] == good_won[1]);
+  assert(replays[0].turns == replays[1].turns);
+  assert(replays[0].sinkTurn[0] == replays[1].sinkTurn[0]);
+  assert(replays[0].sinkTurn[1] == replays[1].sinkTurn[1]);
+
+  std::cout << "Good player won " << good_wins << " of " << TEST_PLAY
+            << " simulated games against a mediocre player, at "
+            << TEST_PLAY / elapsed.count() * 60 << " games per minute."
+            << std::endl;
+
+  std::cerr << "Passed headless game test cases." << std::endl;
+}
+
 int main() {
 // #define PLAY_DEFAULT_GAMES
 #ifdef PLAY_DEFAULT_GAMES
@@ -395,4 +607,7 @@ int main() {
   human_player_tests();
   // mediocre_player_tests();
   // good_player_tests();
+  // density_player_tests();
+  // placement_tests();
+  // headless_tests();
 }
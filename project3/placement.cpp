@@ -0,0 +1,228 @@
+#include "placement.h"
+#include "Board.h"
+#include "Game.h"
+#include "bitboard.h"
+#include "globals.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Every position of a ship of `length` that stays on g's board. A ship of
+// length 1 covers the same cell either way, so it is only ever HORIZONTAL.
+// Each is worked out once per thread for each board size and length.
+const std::vector<ShipPlacement> &all_placements(const Game &g, int length) {
+  const int MAX_LENGTH = std::max(MAXROWS, MAXCOLS);
+  thread_local std::vector<std::vector<ShipPlacement>> cache(
+      static_cast<size_t>(MAXROWS * MAXCOLS * MAX_LENGTH));
+  std::vector<ShipPlacement> &placements =
+      cache[((g.rows() - 1) * MAXCOLS + g.cols() - 1) * MAX_LENGTH + length -
+            1];
+  if (!placements.empty()) {
+    return placements;
+  }
+
+  for (int r = 0; r < g.rows(); r++) {
+    for (int c = 0; c < g.cols(); c++) {
+      const Point top_or_left{r, c};
+      if (c + length <= g.cols()) {
+        placements.push_back(ShipPlacement{
+            top_or_left, HORIZONTAL,
+            Bitboard::ship(top_or_left, length, HORIZONTAL)});
+      }
+      if (length > 1 && r + length <= g.rows()) {
+        placements.push_back(
+            ShipPlacement{top_or_left, VERTICAL,
+                          Bitboard::ship(top_or_left, length, VERTICAL)});
+      }
+    }
+  }
+  return placements;
+}
+
+PlacementSolver::PlacementSolver(
+    std::vector<std::vector<ShipPlacement>> legal)
+    : m_legal{std::move(legal)}, m_stats{0, 0, false} {
+  for (size_t ship_id = 0; ship_id < m_legal.size(); ship_id++) {
+    m_sample_order.push_back(static_cast<int>(ship_id));
+  }
+  // A draw fails at its first overlap, so pick the ships least likely to
+  // fit first
+  std::stable_sort(m_sample_order.begin(), m_sample_order.end(),
+                   [this](int a, int b) {
+                     return m_legal[a].size() < m_legal[b].size();
+                   });
+}
+
+PlacementSolver PlacementSolver::forGame(const Game &g) {
+  std::vector<std::vector<ShipPlacement>> legal;
+  for (int ship_id = 0; ship_id < g.nShips(); ship_id++) {
+    legal.push_back(all_placements(g, g.shipLength(ship_id)));
+  }
+  return PlacementSolver{std::move(legal)};
+}
+
+// Only the shortest ship is tried on b. Before any ship is placed, b rejects
+// a placement only for covering a blocked cell, so the cells the shortest
+// ship can cover are exactly the free cells that any ship can use: a longer
+// ship on free cells has the shortest ship's length of them around each of
+// its cells. Every ship's legal placements are then those on these cells.
+PlacementSolver PlacementSolver::forBoard(const Game &g, Board &b) {
+  int shortest_id = 0;
+  for (int ship_id = 1; ship_id < g.nShips(); ship_id++) {
+    if (g.shipLength(ship_id) < g.shipLength(shortest_id)) {
+      shortest_id = ship_id;
+    }
+  }
+
+  Bitboard usable;
+  if (g.nShips() > 0) {
+    for (const ShipPlacement &p :
+         all_placements(g, g.shipLength(shortest_id))) {
+      if (b.placeShip(p.topOrLeft, shortest_id, p.dir)) {
+        b.unplaceShip(p.topOrLeft, shortest_id, p.dir);
+        usable |= p.cells;
+      }
+    }
+  }
+
+  std::vector<std::vector<ShipPlacement>> legal;
+  for (int ship_id = 0; ship_id < g.nShips(); ship_id++) {
+    const std::vector<ShipPlacement> &placements =
+        all_placements(g, g.shipLength(ship_id));
+    std::vector<ShipPlacement> accepted;
+    accepted.reserve(placements.size());
+    for (const ShipPlacement &p : placements) {
+      if (p.cells.without(usable).none()) {
+        accepted.push_back(p);
+      }
+    }
+    legal.push_back(std::move(accepted));
+  }
+  return PlacementSolver{std::move(legal)};
+}
+
+bool PlacementSolver::solve(std::vector<ShipPlacement> &layout) {
+  m_stats = Stats{0, 0, false};
+
+  // No layout if some ship has nowhere to go, or the ships together cover
+  // more cells than they can reach
+  Bitboard reachable;
+  int total_length = 0;
+  for (const std::vector<ShipPlacement> &placements : m_legal) {
+    if (placements.empty()) {
+      return false;
+    }
+    for (const ShipPlacement &p : placements) {
+      reachable |= p.cells;
+    }
+    total_length += placements.front().cells.count();
+  }
+  if (total_length > reachable.count()) {
+    return false;
+  }
+
+  std::vector<int> choice(m_legal.size(), -1);
+  bool found = false;
+  while (!found && m_stats.samples < MAX_SAMPLES) {
+    m_stats.samples++;
+    found = sample(choice);
+  }
+  m_stats.sampled = found;
+
+  if (!found) {
+    std::fill(choice.begin(), choice.end(), -1);
+    found = search(Bitboard{}, static_cast<int>(m_legal.size()), choice);
+  }
+  if (!found) {
+    return false;
+  }
+
+  layout.clear();
+  for (size_t ship_id = 0; ship_id < m_legal.size(); ship_id++) {
+    layout.push_back(m_legal[ship_id][choice[ship_id]]);
+  }
+  return true;
+}
+
+// One draw of a placement per ship, independently and uniformly; fails at
+// the first overlap
+bool PlacementSolver::sample(std::vector<int> &choice) const {
+  Bitboard occupied;
+  for (int ship_id : m_sample_order) {
+    const std::vector<ShipPlacement> &placements = m_legal[ship_id];
+    const int k = randInt(static_cast<int>(placements.size()));
+    if (placements[k].cells.intersects(occupied)) {
+      return false;
+    }
+    occupied |= placements[k].cells;
+    choice[ship_id] = k;
+  }
+  return true;
+}
+
+// Places the `remaining` ships whose choice is -1 around `occupied`. Gives up,
+// returning false, once it has taken MAX_NODES steps.
+// NOLINTNEXTLINE(misc-no-recursion)
+bool PlacementSolver::search(Bitboard occupied, int remaining,
+                             std::vector<int> &choice) {
+  if (remaining == 0) {
+    return true;
+  }
+  if (++m_stats.nodes > MAX_NODES) {
+    return false;
+  }
+
+  // The unplaced ship with the fewest placements clear of `occupied`; if
+  // any has none, this branch is a dead end
+  int most_constrained = -1;
+  int fewest = 0;
+  for (size_t ship_id = 0; ship_id < m_legal.size(); ship_id++) {
+    if (choice[ship_id] >= 0) {
+      continue;
+    }
+    int clear = 0;
+    for (const ShipPlacement &p : m_legal[ship_id]) {
+      clear += p.cells.intersects(occupied) ? 0 : 1;
+    }
+    if (clear == 0) {
+      return false;
+    }
+    if (most_constrained < 0 || clear < fewest) {
+      most_constrained = static_cast<int>(ship_id);
+      fewest = clear;
+    }
+  }
+
+  // Try its placements starting from a random one
+  const std::vector<ShipPlacement> &placements = m_legal[most_constrained];
+  const int n = static_cast<int>(placements.size());
+  const int start = randInt(n);
+  for (int i = 0; i < n && m_stats.nodes <= MAX_NODES; i++) {
+    const int k = (start + i) % n;
+    if (placements[k].cells.intersects(occupied)) {
+      continue;
+    }
+    choice[most_constrained] = k;
+    if (search(occupied | placements[k].cells, remaining - 1, choice)) {
+      return true;
+    }
+  }
+  choice[most_constrained] = -1;
+  return false;
+}
+
+bool placeShipsRandomly(const Game &g, Board &b) {
+  PlacementSolver solver = PlacementSolver::forBoard(g, b);
+  std::vector<ShipPlacement> layout;
+  if (!solver.solve(layout)) {
+    return false;
+  }
+
+  for (size_t ship_id = 0; ship_id < layout.size(); ship_id++) {
+    const ShipPlacement &p = layout[ship_id];
+    b.placeShip(p.topOrLeft, static_cast<int>(ship_id), p.dir);
+  }
+  return true;
+}
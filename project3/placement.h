@@ -0,0 +1,74 @@
+#ifndef PLACEMENT_INCLUDED
+#define PLACEMENT_INCLUDED
+
+#include "bitboard.h"
+#include "globals.h"
+#include <vector>
+
+class Board;
+class Game;
+
+// Where one ship goes
+struct ShipPlacement {
+  Point topOrLeft;
+  Direction dir;
+  Bitboard cells;
+};
+
+// Finds layouts of a fleet: one placement per ship, no two overlapping.
+// Each ship chooses from a fixed list of legal placements, so the cells a
+// ship may cover are precomputed as Bitboards and checking a layout is a
+// handful of word operations.
+//
+// solve() first draws layouts by rejection sampling: every ship picks one of
+// its placements uniformly at random, and the draw is thrown away at the
+// first overlap. A layout that survives is uniformly distributed over all
+// valid layouts. If MAX_SAMPLES draws all fail, because valid layouts are
+// rare, it falls back to a depth-first search that places the ship with the
+// fewest placements left first and backtracks as soon as any unplaced ship
+// has none (forward checking). The search tries placements in random order
+// but its layouts are not uniform. Either way a call does at most
+// MAX_SAMPLES draws and MAX_NODES search steps, so its work is bounded even
+// when no layout exists.
+class PlacementSolver {
+public:
+  static const int MAX_SAMPLES = 2000;
+  static const long long MAX_NODES = 20000;
+
+  // What the last call to solve() did
+  struct Stats {
+    int samples;     // Rejection-sampling draws
+    long long nodes; // Search steps, 0 if a draw succeeded
+    bool sampled;    // Whether the layout came from a draw, so is uniform
+  };
+
+  // legal[shipId] lists the placements that ship may take
+  explicit PlacementSolver(std::vector<std::vector<ShipPlacement>> legal);
+
+  // Every placement of each of g's ships on an empty board
+  static PlacementSolver forGame(const Game &g);
+  // The placements b accepts for each of g's ships, found by placing and
+  // unplacing the shortest. None of g's ships may be on b.
+  static PlacementSolver forBoard(const Game &g, Board &b);
+
+  // Fills `layout`, indexed by ship ID. Returns false if it found no layout
+  // within its bounds.
+  bool solve(std::vector<ShipPlacement> &layout);
+  const Stats &stats() const { return m_stats; }
+
+private:
+  bool sample(std::vector<int> &choice) const;
+  bool search(Bitboard occupied, int remaining, std::vector<int> &choice);
+
+  std::vector<std::vector<ShipPlacement>> m_legal; // Indexed by ship ID
+  std::vector<int> m_sample_order; // Ship IDs, most constrained first
+  Stats m_stats;
+};
+
+// Places all of g's ships on b, as a player's placeShips does: a layout
+// drawn uniformly from those b accepts, or failing that the first one the
+// bounded search finds. Returns false, with no ships placed, if there is
+// none within the solver's bounds.
+bool placeShipsRandomly(const Game &g, Board &b);
+
+#endif // PLACEMENT_INCLUDED
@@ -0,0 +1,70 @@
+#ifndef RNG_INCLUDED
+#define RNG_INCLUDED
+
+#include <cstdint>
+#include <random>
+
+// A small, fast pseudorandom number generator: xoshiro256** by Blackman and
+// Vigna. Its whole state is four 64-bit words, so it is cheap to keep one per
+// thread and to reseed. The same seed always gives the same sequence.
+class Rng {
+public:
+  explicit Rng(uint64_t seed) { reseed(seed); }
+
+  // Spreads `seed` over the state with splitmix64, as the authors recommend,
+  // so nearby seeds still give unrelated sequences
+  void reseed(uint64_t seed) {
+    for (uint64_t &word : m_state) {
+      seed += 0x9e3779b97f4a7c15;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  uint64_t next() {
+    const uint64_t result = rotl(m_state[1] * 5, 7) * 9;
+    const uint64_t t = m_state[1] << 17;
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+    m_state[2] ^= t;
+    m_state[3] = rotl(m_state[3], 45);
+    return result;
+  }
+
+  // A uniformly distributed int from 0 to limit-1, by Lemire's multiply and
+  // shift: the high half of a 32x32-bit product is the result, and the rare
+  // draws that would favor some results over others are thrown away. No
+  // division unless a draw lands in the biased range.
+  uint32_t below(uint32_t limit) {
+    uint64_t product = (next() >> 32) * limit;
+    auto low = static_cast<uint32_t>(product);
+    if (low < limit) {
+      const uint32_t threshold = -limit % limit;
+      while (low < threshold) {
+        product = (next() >> 32) * limit;
+        low = static_cast<uint32_t>(product);
+      }
+    }
+    return static_cast<uint32_t>(product >> 32);
+  }
+
+private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  uint64_t m_state[4];
+};
+
+// The calling thread's generator. Each thread starts from its own seed from
+// std::random_device; call reseed() on it to make a run reproducible.
+inline Rng &threadRng() {
+  thread_local Rng rng(
+      (static_cast<uint64_t>(std::random_device{}()) << 32) ^
+      std::random_device{}());
+  return rng;
+}
+
+#endif // RNG_INCLUDED
@@ -0,0 +1,346 @@
+// Round-robin Battleship tournament
+//
+// Usage:  tournament [--option=value ...]
+//
+//   --players=A,B,...   createPlayer types to enter
+//                       (awful,mediocre,good,density)
+//   --games=N           games per pairing (100000)
+//   --threads=N         worker threads (hardware threads)
+//   --self              also pair each player with itself
+//   --seed=N            random seed (a fresh one, printed, if not given)
+//
+// Build with Board.cpp, Game.cpp, Player.cpp, placement.cpp and utility.cpp
+// in place of main.cpp.  Every pairing plays its games with Game::simulate,
+// each player going first in half of them.  The games are dealt to the
+// workers in blocks; each worker has its own Game and its own random number
+// generator, creates fresh players for every game, and keeps its own tallies,
+// which are merged once all the games are done.  So the workers share nothing
+// but a counter, and the tournament scales with the number of cores.  Each
+// block reseeds its worker's generator from the seed and the block's number,
+// so a seed gives the same results whatever the number of threads.
+//
+// Prints, for each player, its win rate with a 95% Wilson score interval and
+// the distribution of the shots it needed to win, then the win rate of each
+// player against each other.
+
+#include "Game.h"
+#include "Player.h"
+#include "globals.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int GAMES_PER_BLOCK = 1000;
+
+// A game can never take more shots than there are cells
+const int MAX_SHOTS = MAXROWS * MAXCOLS;
+
+bool addStandardShips(Game &g) {
+  return g.addShip(5, 'A', "aircraft carrier") &&
+         g.addShip(4, 'B', "battleship") && g.addShip(3, 'D', "destroyer") &&
+         g.addShip(3, 'S', "submarine") && g.addShip(2, 'P', "patrol boat");
+}
+
+struct Pairing {
+  int first;
+  int second;
+};
+
+// One player's side of one pairing
+struct Tally {
+  long long games;
+  long long wins;
+  vector<long long> shotsToWin; // shotsToWin[s] counts wins that took s shots
+
+  Tally() : games(0), wins(0), shotsToWin(MAX_SHOTS + 1, 0) {}
+
+  void add(const Tally &other) {
+    games += other.games;
+    wins += other.wins;
+    for (int s = 0; s <= MAX_SHOTS; s++) {
+      shotsToWin[s] += other.shotsToWin[s];
+    }
+  }
+};
+
+// tallies[pairing][0] is the pairing's first player, [1] its second
+using Tallies = vector<array<Tally, 2>>;
+
+bool parseOption(const string &arg, const string &name, string &value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+// The 95% Wilson score interval for a proportion of wins out of games
+void wilsonInterval(long long wins, long long games, double &low,
+                    double &high) {
+  const double Z = 1.96;
+  if (games == 0) {
+    low = 0;
+    high = 1;
+    return;
+  }
+  double n = static_cast<double>(games);
+  double p = wins / n;
+  double center = (p + Z * Z / (2 * n)) / (1 + Z * Z / n);
+  double margin =
+      Z * sqrt(p * (1 - p) / n + Z * Z / (4 * n * n)) / (1 + Z * Z / n);
+  low = center - margin;
+  high = center + margin;
+}
+
+// Plays games [first, last) of `pairing`; even games go to the pairing's
+// first player
+void playBlock(Game &g, const vector<string> &types, const Pairing &pairing,
+               long long first, long long last, array<Tally, 2> &tally) {
+  for (long long k = first; k < last; k++) {
+    Player *players[2] = {createPlayer(types[pairing.first], "first", g),
+                          createPlayer(types[pairing.second], "second", g)};
+    const int starter = k % 2 == 0 ? 0 : 1;
+    GameResult result = g.simulate(players[starter], players[1 - starter]);
+
+    for (int side = 0; side < 2; side++) {
+      tally[side].games++;
+    }
+    if (result.winner != nullptr) {
+      const int winner = result.winner == players[0] ? 0 : 1;
+      const int shots = result.shots[winner == starter ? 0 : 1];
+      tally[winner].wins++;
+      tally[winner].shotsToWin[min(shots, MAX_SHOTS)]++;
+    }
+    delete players[0];
+    delete players[1];
+  }
+}
+
+void printShots(const Tally &tally) {
+  long long wins = 0;
+  double sum = 0;
+  double sumSquares = 0;
+  for (int s = 0; s <= MAX_SHOTS; s++) {
+    wins += tally.shotsToWin[s];
+    sum += static_cast<double>(s) * tally.shotsToWin[s];
+    sumSquares += static_cast<double>(s) * s * tally.shotsToWin[s];
+  }
+  if (wins == 0) {
+    cout << "    no wins" << endl;
+    return;
+  }
+
+  double mean = sum / wins;
+  double variance = wins > 1 ? (sumSquares - sum * mean) / (wins - 1) : 0;
+  double margin = 1.96 * sqrt(max(variance, 0.0) / wins);
+
+  // Percentiles straight from the histogram
+  int percentiles[3] = {10, 50, 90};
+  int atPercentile[3] = {0, 0, 0};
+  for (int p = 0; p < 3; p++) {
+    long long needed = (wins * percentiles[p] + 99) / 100;
+    long long seen = 0;
+    for (int s = 0; s <= MAX_SHOTS; s++) {
+      seen += tally.shotsToWin[s];
+      if (seen >= needed) {
+        atPercentile[p] = s;
+        break;
+      }
+    }
+  }
+
+  cout << fixed << setprecision(2) << "    shots to win: mean " << mean
+       << " +/- " << margin << ", sd " << sqrt(max(variance, 0.0))
+       << ", p10 " << atPercentile[0] << ", median " << atPercentile[1]
+       << ", p90 " << atPercentile[2] << endl;
+
+  // A histogram in buckets of 5 shots, scaled to the fullest bucket
+  const int BUCKET = 5;
+  const int WIDTH = 50;
+  vector<long long> buckets(MAX_SHOTS / BUCKET + 1, 0);
+  for (int s = 0; s <= MAX_SHOTS; s++) {
+    buckets[s / BUCKET] += tally.shotsToWin[s];
+  }
+  long long fullest = *max_element(buckets.begin(), buckets.end());
+  for (size_t b = 0; b < buckets.size(); b++) {
+    if (buckets[b] == 0) {
+      continue;
+    }
+    int width = static_cast<int>(buckets[b] * WIDTH / fullest);
+    cout << "    " << setw(3) << b * BUCKET << "-" << setw(3)
+         << b * BUCKET + BUCKET - 1 << " " << string(width, '#') << " "
+         << buckets[b] << endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  vector<string> types = {"awful", "mediocre", "good", "density"};
+  long long gamesPerPairing = 100000;
+  int nthreads = static_cast<int>(thread::hardware_concurrency());
+  bool selfPlay = false;
+  uint64_t seed = (static_cast<uint64_t>(random_device{}()) << 32) ^
+                  random_device{}();
+
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    string value;
+    if (parseOption(arg, "players", value)) {
+      types.clear();
+      istringstream iss(value);
+      string type;
+      while (getline(iss, type, ',')) {
+        types.push_back(type);
+      }
+    } else if (parseOption(arg, "games", value)) {
+      gamesPerPairing = atoll(value.c_str());
+    } else if (parseOption(arg, "threads", value)) {
+      nthreads = atoi(value.c_str());
+    } else if (parseOption(arg, "seed", value)) {
+      seed = strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--self") {
+      selfPlay = true;
+    } else {
+      cerr << "Unknown option " << arg << endl;
+      return 2;
+    }
+  }
+  if (nthreads < 1) {
+    nthreads = 1;
+  }
+
+  // Check the types up front rather than in every worker
+  {
+    Game g(MAXROWS, MAXCOLS);
+    addStandardShips(g);
+    for (const string &type : types) {
+      Player *p = createPlayer(type, type, g);
+      if (p == nullptr || p->isHuman()) {
+        cerr << "Cannot enter a player of type \"" << type << "\"" << endl;
+        delete p;
+        return 2;
+      }
+      delete p;
+    }
+  }
+
+  vector<Pairing> pairings;
+  for (size_t i = 0; i < types.size(); i++) {
+    for (size_t j = selfPlay ? i : i + 1; j < types.size(); j++) {
+      pairings.push_back(Pairing{static_cast<int>(i), static_cast<int>(j)});
+    }
+  }
+  if (pairings.empty()) {
+    cerr << "A tournament needs at least two players" << endl;
+    return 2;
+  }
+
+  const long long blocksPerPairing =
+      (gamesPerPairing + GAMES_PER_BLOCK - 1) / GAMES_PER_BLOCK;
+  const long long totalBlocks = blocksPerPairing * pairings.size();
+  atomic<long long> nextBlock(0);
+  vector<Tallies> workerTallies(nthreads, Tallies(pairings.size()));
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  vector<thread> workers;
+  for (int t = 0; t < nthreads; t++) {
+    workers.emplace_back([&, t] {
+      Game g(MAXROWS, MAXCOLS);
+      addStandardShips(g);
+      Tallies &tallies = workerTallies[t];
+      for (long long block = nextBlock++; block < totalBlocks;
+           block = nextBlock++) {
+        const size_t p = static_cast<size_t>(block / blocksPerPairing);
+        const long long first = block % blocksPerPairing * GAMES_PER_BLOCK;
+        const long long last = min(first + GAMES_PER_BLOCK, gamesPerPairing);
+        seedRandom(seed + static_cast<uint64_t>(block) * 0x9e3779b97f4a7c15);
+        playBlock(g, types, pairings[p], first, last, tallies[p]);
+      }
+    });
+  }
+  for (thread &worker : workers) {
+    worker.join();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+  Tallies tallies(pairings.size());
+  for (const Tallies &worker : workerTallies) {
+    for (size_t p = 0; p < pairings.size(); p++) {
+      tallies[p][0].add(worker[p][0]);
+      tallies[p][1].add(worker[p][1]);
+    }
+  }
+
+  const long long totalGames = gamesPerPairing * pairings.size();
+  cout << totalGames << " games on " << nthreads << " threads in " << fixed
+       << setprecision(2) << elapsed.count() << " s ("
+       << setprecision(0) << totalGames / elapsed.count() * 60
+       << " games per minute), seed " << seed << endl
+       << endl;
+
+  // Each player's results over all of its pairings
+  for (size_t i = 0; i < types.size(); i++) {
+    Tally overall;
+    for (size_t p = 0; p < pairings.size(); p++) {
+      if (pairings[p].first == static_cast<int>(i)) {
+        overall.add(tallies[p][0]);
+      }
+      if (pairings[p].second == static_cast<int>(i)) {
+        overall.add(tallies[p][1]);
+      }
+    }
+    double low;
+    double high;
+    wilsonInterval(overall.wins, overall.games, low, high);
+    cout << types[i] << ": won " << overall.wins << " of " << overall.games
+         << setprecision(2) << " (" << 100.0 * overall.wins / overall.games
+         << "%, 95% CI " << 100 * low << "-" << 100 * high << "%)" << endl;
+    printShots(overall);
+  }
+
+  // How each player fared against each other, as row against column
+  cout << endl << "Win rate of row against column" << endl << setw(12) << "";
+  for (const string &type : types) {
+    cout << setw(24) << type;
+  }
+  cout << endl;
+  for (size_t i = 0; i < types.size(); i++) {
+    cout << setw(12) << types[i];
+    for (size_t j = 0; j < types.size(); j++) {
+      const Tally *tally = nullptr;
+      for (size_t p = 0; p < pairings.size(); p++) {
+        if (pairings[p].first == static_cast<int>(i) &&
+            pairings[p].second == static_cast<int>(j)) {
+          tally = &tallies[p][0];
+        } else if (pairings[p].first == static_cast<int>(j) &&
+                   pairings[p].second == static_cast<int>(i)) {
+          tally = &tallies[p][1];
+        }
+      }
+      if (tally == nullptr) {
+        cout << setw(24) << "-";
+        continue;
+      }
+      double low;
+      double high;
+      wilsonInterval(tally->wins, tally->games, low, high);
+      ostringstream cell;
+      cell << fixed << setprecision(1) << 100.0 * tally->wins / tally->games
+           << "% [" << 100 * low << "," << 100 * high << "]";
+      cout << setw(24) << cell.str();
+    }
+    cout << endl;
+  }
+}
@@ -0,0 +1,211 @@
+// CommandLog.h
+
+// A compact binary form of a commands.txt workload, and a reader that works
+// directly on the bytes of a memory-mapped file.
+//
+// Layout (native byte order, every field 4-byte aligned):
+//
+//   CommandLogHeader
+//   identifier table   idCount entries, each a uint32_t length followed by
+//                      that many characters, padded to a multiple of 4 bytes
+//   command words      wordCount uint32_t words
+//
+// Each command is one word holding (symbol << 2) | opcode, where symbol is an
+// index into the identifier table and is 0 for the scope opcodes.  A DECLARE
+// word is followed by one more word holding the line number.
+
+#ifndef COMMANDLOG_INCLUDED
+#define COMMANDLOG_INCLUDED
+
+#include "Workload.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+const char COMMAND_LOG_MAGIC[4] = {'N', 'T', 'C', 'L'};
+const uint32_t COMMAND_LOG_VERSION = 1;
+
+enum CommandOpcode : uint32_t {
+  OP_ENTER_SCOPE = 0,
+  OP_EXIT_SCOPE = 1,
+  OP_DECLARE = 2,
+  OP_FIND = 3
+};
+
+const uint32_t OPCODE_BITS = 2;
+const uint32_t OPCODE_MASK = (1U << OPCODE_BITS) - 1;
+
+struct CommandLogHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t idCount;
+  uint32_t wordCount;
+  uint64_t idTableBytes;
+};
+
+inline size_t paddedLength(size_t length) { return (length + 3) & ~size_t{3}; }
+
+// Write commands in binary form.  Each distinct identifier is stored once.
+// Returns false if the log would have too many identifiers to encode.
+inline bool writeCommandLog(std::ostream &outf,
+                            const std::vector<WorkloadCommand> &commands) {
+  std::unordered_map<std::string, uint32_t> symbols;
+  std::vector<const std::string *> ids;
+  std::vector<uint32_t> words;
+  words.reserve(commands.size() * 2);
+
+  for (const WorkloadCommand &cmd : commands) {
+    switch (cmd.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+      words.push_back(OP_ENTER_SCOPE);
+      break;
+    case WorkloadCommand::EXIT_SCOPE:
+      words.push_back(OP_EXIT_SCOPE);
+      break;
+    case WorkloadCommand::DECLARE:
+    case WorkloadCommand::FIND: {
+      auto inserted =
+          symbols.emplace(cmd.id, static_cast<uint32_t>(symbols.size()));
+      if (inserted.second)
+        ids.push_back(&inserted.first->first);
+      uint32_t symbol = inserted.first->second;
+      if (symbol > (UINT32_MAX >> OPCODE_BITS))
+        return false;
+      if (cmd.kind == WorkloadCommand::DECLARE) {
+        words.push_back(symbol << OPCODE_BITS | OP_DECLARE);
+        words.push_back(static_cast<uint32_t>(cmd.lineNum));
+      } else
+        words.push_back(symbol << OPCODE_BITS | OP_FIND);
+      break;
+    }
+    }
+  }
+
+  CommandLogHeader header;
+  memcpy(header.magic, COMMAND_LOG_MAGIC, sizeof(header.magic));
+  header.version = COMMAND_LOG_VERSION;
+  header.idCount = static_cast<uint32_t>(ids.size());
+  header.wordCount = static_cast<uint32_t>(words.size());
+  header.idTableBytes = 0;
+  for (const std::string *id : ids)
+    header.idTableBytes += sizeof(uint32_t) + paddedLength(id->size());
+
+  outf.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  const char padding[4] = {0, 0, 0, 0};
+  for (const std::string *id : ids) {
+    uint32_t length = static_cast<uint32_t>(id->size());
+    outf.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    outf.write(id->data(), static_cast<std::streamsize>(length));
+    outf.write(padding, static_cast<std::streamsize>(paddedLength(length) -
+                                                     length));
+  }
+  outf.write(reinterpret_cast<const char *>(words.data()),
+             static_cast<std::streamsize>(words.size() * sizeof(uint32_t)));
+  return static_cast<bool>(outf);
+}
+
+// A read-only view of a binary command log held in memory.  Nothing is
+// copied: identifiers are views into the log's bytes and commands are read
+// straight from its words.
+class CommandLogView {
+public:
+  // Returns false if data does not hold a well-formed log
+  bool open(const char *data, size_t size) {
+    if (size < sizeof(CommandLogHeader))
+      return false;
+    memcpy(&m_header, data, sizeof(m_header));
+    if (memcmp(m_header.magic, COMMAND_LOG_MAGIC, sizeof(m_header.magic)) != 0 ||
+        m_header.version != COMMAND_LOG_VERSION ||
+        m_header.idTableBytes > size - sizeof(CommandLogHeader) ||
+        (size - sizeof(CommandLogHeader) - m_header.idTableBytes) /
+                sizeof(uint32_t) <
+            m_header.wordCount)
+      return false;
+    m_idTable = data + sizeof(CommandLogHeader);
+    m_words = reinterpret_cast<const uint32_t *>(m_idTable +
+                                                 m_header.idTableBytes);
+    return true;
+  }
+
+  uint32_t idCount() const { return m_header.idCount; }
+  uint32_t wordCount() const { return m_header.wordCount; }
+  const uint32_t *words() const { return m_words; }
+
+  // Call f(symbol, id) for every identifier in the table, in symbol order.
+  // Returns false if the table is malformed.
+  template <typename Function> bool forEachId(Function f) const {
+    const char *p = m_idTable;
+    const char *end = m_idTable + m_header.idTableBytes;
+    for (uint32_t symbol = 0; symbol < m_header.idCount; symbol++) {
+      uint32_t length;
+      if (end - p < static_cast<std::ptrdiff_t>(sizeof(length)))
+        return false;
+      memcpy(&length, p, sizeof(length));
+      p += sizeof(length);
+      if (static_cast<size_t>(end - p) < paddedLength(length))
+        return false;
+      f(symbol, std::string_view(p, length));
+      p += paddedLength(length);
+    }
+    return true;
+  }
+
+private:
+  CommandLogHeader m_header{};
+  const char *m_idTable = nullptr;
+  const uint32_t *m_words = nullptr;
+};
+
+// A file mapped read-only into memory
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+    void *p = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                   MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+      return false;
+    m_data = static_cast<const char *>(p);
+    m_size = static_cast<size_t>(info.st_size);
+    return true;
+  }
+
+  void close() {
+    if (m_data != nullptr)
+      munmap(const_cast<char *>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+};
+
+#endif // COMMANDLOG_INCLUDED
@@ -0,0 +1,304 @@
+#include "ConcurrentNameTable.h"
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ConcurrentNameTable::Symbol {
+  std::string identifier; // Never changes once the symbol is published
+  size_t hash;
+  std::atomic<int> line; // Line of the innermost declaration in scope, or -1
+  int innermost;         // Index into `m_active_ids`; only the writer uses it
+};
+
+// An open-addressing index from identifiers to symbols. Each slot packs the
+// upper half of the identifier's hash with the symbol number plus one, so a
+// reader sees an entry appear all at once, and an empty slot is 0. Entries
+// never move, so readers use plain linear probing; when the index gets too
+// full the writer builds a bigger one and swaps it in.
+struct ConcurrentNameTable::Index {
+  explicit Index(size_t capacity)
+      : mask{capacity - 1}, size{0},
+        slots{new std::atomic<uint64_t>[capacity]} {
+    for (size_t i = 0; i < capacity; i++) {
+      slots[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  size_t mask;
+  size_t size;
+  std::unique_ptr<std::atomic<uint64_t>[]> slots;
+};
+
+struct ConcurrentNameTable::Declaration {
+  int32_t symbol;
+  int line;
+  int shadowed; // Index into `m_active_ids`, or -1 if nothing is shadowed
+};
+
+struct ConcurrentNameTable::Retired {
+  Index *index;
+  uint64_t epoch;
+};
+
+// Capacity must stay a power of two so that probes can mask instead of mod
+const size_t INITIAL_CAPACITY = 64;
+
+// Grow once the index is half full. Entries cannot be reordered while readers
+// are probing, so this keeps plain linear probes short.
+const size_t MAX_LOAD_NUMERATOR = 1;
+const size_t MAX_LOAD_DENOMINATOR = 2;
+
+const int32_t FIRST_SEGMENT_SIZE = 1024;
+
+ConcurrentNameTable::ConcurrentNameTable()
+    : m_num_symbols{0}, m_index{new Index{INITIAL_CAPACITY}}, m_epoch{0},
+      m_scope_starts{0} {
+  for (std::atomic<Symbol *> &segment : m_segments) {
+    segment.store(nullptr, std::memory_order_relaxed);
+  }
+  for (int i = 0; i < MAX_READERS; i++) {
+    m_reader_epochs[i].store(IDLE, std::memory_order_relaxed);
+    m_reader_in_use[i].store(false, std::memory_order_relaxed);
+  }
+}
+
+ConcurrentNameTable::~ConcurrentNameTable() {
+  delete m_index.load(std::memory_order_relaxed);
+  for (const Retired &retired : m_retired) {
+    delete retired.index;
+  }
+  for (std::atomic<Symbol *> &segment : m_segments) {
+    delete[] segment.load(std::memory_order_relaxed);
+  }
+}
+
+void ConcurrentNameTable::enterScope() {
+  m_scope_starts.push_back(static_cast<int>(m_active_ids.size()));
+}
+
+bool ConcurrentNameTable::exitScope() {
+  // The global scope can never be exited
+  if (m_scope_starts.size() == 1) {
+    return false;
+  }
+
+  // Unshadow whatever each declaration in the closing scope hid
+  const int start = m_scope_starts.back();
+  for (int i = static_cast<int>(m_active_ids.size()) - 1; i >= start; i--) {
+    const Declaration &current_id = m_active_ids[i];
+    Symbol &symbol = symbol_at(current_id.symbol);
+    symbol.innermost = current_id.shadowed;
+    symbol.line.store(current_id.shadowed == -1
+                          ? -1
+                          : m_active_ids[current_id.shadowed].line,
+                      std::memory_order_release);
+  }
+
+  m_active_ids.resize(start);
+  m_scope_starts.pop_back();
+  return true;
+}
+
+bool ConcurrentNameTable::declare(std::string_view id, int lineNum) {
+  if (id.empty()) {
+    return false;
+  }
+
+  const size_t hash_value = calculate_hash(id);
+  int32_t symbol = find_symbol(m_index.load(std::memory_order_relaxed), id,
+                               hash_value);
+  if (symbol == -1) {
+    symbol = add_symbol(id, hash_value);
+  }
+
+  Symbol &data = symbol_at(symbol);
+
+  // Check for an already existing declaration in the same scope
+  if (data.innermost >= m_scope_starts.back()) {
+    return false;
+  }
+
+  m_active_ids.push_back(Declaration{symbol, lineNum, data.innermost});
+  data.innermost = static_cast<int>(m_active_ids.size()) - 1;
+  data.line.store(lineNum, std::memory_order_release);
+  return true;
+}
+
+// The writer never frees an index it might be reading, so it needs no epoch
+int ConcurrentNameTable::find(std::string_view id) const {
+  return find_in(m_index.load(std::memory_order_relaxed), id);
+}
+
+ConcurrentNameTable::Reader ConcurrentNameTable::reader() {
+  for (int i = 0; i < MAX_READERS; i++) {
+    bool in_use = false;
+    if (m_reader_in_use[i].compare_exchange_strong(in_use, true)) {
+      return Reader{this, i};
+    }
+  }
+  throw std::runtime_error("Too many ConcurrentNameTable readers");
+}
+
+size_t ConcurrentNameTable::calculate_hash(std::string_view identifier) {
+  return std::hash<std::string_view>{}(identifier);
+}
+
+uint64_t ConcurrentNameTable::make_slot(size_t hash, int32_t symbol) {
+  return (static_cast<uint64_t>(hash) >> 32 << 32) |
+         static_cast<uint32_t>(symbol + 1);
+}
+
+ConcurrentNameTable::Symbol &
+ConcurrentNameTable::symbol_at(int32_t symbol) const {
+  // Segment k holds FIRST_SEGMENT_SIZE << k symbols
+  int64_t n = symbol / FIRST_SEGMENT_SIZE + 1;
+  int segment = 0;
+  while (n >>= 1) {
+    segment++;
+  }
+  const int32_t offset =
+      symbol - FIRST_SEGMENT_SIZE * ((int32_t{1} << segment) - 1);
+  return m_segments[segment].load(std::memory_order_acquire)[offset];
+}
+
+// Returns the symbol for `identifier`, or -1 if it has never been declared
+int32_t ConcurrentNameTable::find_symbol(const Index *index,
+                                         std::string_view identifier,
+                                         size_t hash) const {
+  const uint64_t tag = make_slot(hash, -1);
+  for (size_t i = hash & index->mask;; i = (i + 1) & index->mask) {
+    const uint64_t slot = index->slots[i].load(std::memory_order_acquire);
+    if (slot == 0) {
+      return -1;
+    }
+    if ((slot & ~uint64_t{UINT32_MAX}) == tag) {
+      const int32_t symbol = static_cast<int32_t>(slot & UINT32_MAX) - 1;
+      if (symbol_at(symbol).identifier == identifier) {
+        return symbol;
+      }
+    }
+  }
+}
+
+int ConcurrentNameTable::find_in(const Index *index,
+                                 std::string_view id) const {
+  if (id.empty()) {
+    return -1;
+  }
+
+  const int32_t symbol = find_symbol(index, id, calculate_hash(id));
+  if (symbol == -1) {
+    return -1;
+  }
+  return symbol_at(symbol).line.load(std::memory_order_acquire);
+}
+
+int32_t ConcurrentNameTable::add_symbol(std::string_view identifier,
+                                        size_t hash) {
+  const int32_t symbol = m_num_symbols;
+  int64_t n = symbol / FIRST_SEGMENT_SIZE + 1;
+  int segment = 0;
+  while (n >>= 1) {
+    segment++;
+  }
+  if (m_segments[segment].load(std::memory_order_relaxed) == nullptr) {
+    m_segments[segment].store(new Symbol[FIRST_SEGMENT_SIZE << segment],
+                              std::memory_order_release);
+  }
+
+  Symbol &data = symbol_at(symbol);
+  data.identifier = std::string{identifier};
+  data.hash = hash;
+  data.line.store(-1, std::memory_order_relaxed);
+  data.innermost = -1;
+  m_num_symbols++;
+
+  Index *index = m_index.load(std::memory_order_relaxed);
+  if ((index->size + 1) * MAX_LOAD_DENOMINATOR >
+      (index->mask + 1) * MAX_LOAD_NUMERATOR) {
+    grow();
+    index = m_index.load(std::memory_order_relaxed);
+  }
+
+  // Publishing the slot publishes the symbol
+  insert(index, hash, symbol);
+  return symbol;
+}
+
+void ConcurrentNameTable::insert(Index *index, size_t hash, int32_t symbol) {
+  size_t i = hash & index->mask;
+  while (index->slots[i].load(std::memory_order_relaxed) != 0) {
+    i = (i + 1) & index->mask;
+  }
+  index->slots[i].store(make_slot(hash, symbol), std::memory_order_release);
+  index->size++;
+}
+
+// Build a bigger index off to the side, swap it in, and retire the old one
+// until no reader can still be probing it
+void ConcurrentNameTable::grow() {
+  Index *old_index = m_index.load(std::memory_order_relaxed);
+  auto *new_index = new Index{(old_index->mask + 1) * 2};
+  for (int32_t symbol = 0; symbol < m_num_symbols; symbol++) {
+    const Symbol &data = symbol_at(symbol);
+    if (find_symbol(old_index, data.identifier, data.hash) == symbol) {
+      insert(new_index, data.hash, symbol);
+    }
+  }
+
+  m_index.store(new_index, std::memory_order_seq_cst);
+  m_retired.push_back(Retired{old_index, m_epoch.fetch_add(1)});
+  reclaim();
+}
+
+void ConcurrentNameTable::reclaim() {
+  uint64_t oldest_active = IDLE;
+  for (const std::atomic<uint64_t> &epoch : m_reader_epochs) {
+    const uint64_t reader_epoch = epoch.load(std::memory_order_seq_cst);
+    if (reader_epoch < oldest_active) {
+      oldest_active = reader_epoch;
+    }
+  }
+
+  size_t kept = 0;
+  for (const Retired &retired : m_retired) {
+    if (retired.epoch < oldest_active) {
+      delete retired.index;
+    } else {
+      m_retired[kept++] = retired;
+    }
+  }
+  m_retired.resize(kept);
+}
+
+//*********** Reader functions **************
+
+ConcurrentNameTable::Reader::Reader(ConcurrentNameTable *table, int slot)
+    : m_table{table}, m_slot{slot} {}
+
+ConcurrentNameTable::Reader::Reader(Reader &&other) noexcept
+    : m_table{other.m_table}, m_slot{other.m_slot} {
+  other.m_table = nullptr;
+}
+
+ConcurrentNameTable::Reader::~Reader() {
+  if (m_table != nullptr) {
+    m_table->m_reader_in_use[m_slot].store(false, std::memory_order_release);
+  }
+}
+
+// Announce the epoch before loading the index, so that the writer either sees
+// the announcement and keeps the index alive, or has already swapped in a new
+// index that this load will see
+int ConcurrentNameTable::Reader::find(std::string_view id) const {
+  std::atomic<uint64_t> &epoch = m_table->m_reader_epochs[m_slot];
+  epoch.store(m_table->m_epoch.load(std::memory_order_seq_cst),
+              std::memory_order_seq_cst);
+  const int line =
+      m_table->find_in(m_table->m_index.load(std::memory_order_seq_cst), id);
+  epoch.store(IDLE, std::memory_order_release);
+  return line;
+}
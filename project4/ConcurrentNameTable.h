@@ -0,0 +1,104 @@
+#ifndef CONCURRENTNAMETABLE_INCLUDED
+#define CONCURRENTNAMETABLE_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A name table that one writer thread updates while any number of reader
+// threads look identifiers up at the same time.
+//
+// Only one thread may call enterScope, exitScope, declare or find on the table
+// itself.  Every other thread looks identifiers up through a Reader.  A
+// Reader's find never blocks and never waits for the writer or for other
+// readers: it takes a bounded number of steps however the other threads are
+// scheduled.  Each lookup sees the identifier as it was at some moment during
+// the call, but one scope exit can affect many identifiers, and a reader that
+// looks up several of them may see some before and some after the exit.
+class ConcurrentNameTable {
+public:
+  class Reader;
+
+  // At most this many Readers may exist at once
+  static const int MAX_READERS = 64;
+
+  ConcurrentNameTable();
+  ~ConcurrentNameTable();
+  void enterScope();
+  bool exitScope();
+  bool declare(std::string_view id, int lineNum);
+  int find(std::string_view id) const;
+
+  // Returns a reader for use by one thread, or throws std::runtime_error if
+  // MAX_READERS readers already exist.  Readers must be destroyed before the
+  // table.
+  Reader reader();
+
+  // Prevent a ConcurrentNameTable from being copied or assigned
+  ConcurrentNameTable(const ConcurrentNameTable &) = delete;
+  ConcurrentNameTable &operator=(const ConcurrentNameTable &) = delete;
+
+private:
+  struct Symbol;
+  struct Index;
+  struct Declaration;
+  struct Retired;
+
+  static size_t calculate_hash(std::string_view identifier);
+  static uint64_t make_slot(size_t hash, int32_t symbol);
+
+  Symbol &symbol_at(int32_t symbol) const;
+  int32_t find_symbol(const Index *index, std::string_view identifier,
+                      size_t hash) const;
+  int find_in(const Index *index, std::string_view id) const;
+  int32_t add_symbol(std::string_view identifier, size_t hash);
+  void insert(Index *index, size_t hash, int32_t symbol);
+  void grow();
+  void reclaim();
+
+  // Symbols live in segments that never move once allocated, each twice the
+  // size of the one before, so readers can hold on to a symbol while the
+  // writer adds more.
+  static const int NUM_SEGMENTS = 32;
+  std::atomic<Symbol *> m_segments[NUM_SEGMENTS];
+  int32_t m_num_symbols;
+
+  std::atomic<Index *> m_index;
+
+  // Epoch-based reclamation of replaced indexes. A reader publishes the epoch
+  // it started in, and an index retired in epoch E is freed once no reader is
+  // still in an epoch at or before E.
+  static const uint64_t IDLE = UINT64_MAX;
+  std::atomic<uint64_t> m_epoch;
+  std::atomic<uint64_t> m_reader_epochs[MAX_READERS];
+  std::atomic<bool> m_reader_in_use[MAX_READERS];
+  std::vector<Retired> m_retired;
+
+  // Writer-only state, as in NameTableImpl
+  std::vector<Declaration> m_active_ids;
+  std::vector<int> m_scope_starts;
+};
+
+// A handle through which one thread looks identifiers up
+class ConcurrentNameTable::Reader {
+public:
+  Reader(Reader &&other) noexcept;
+  ~Reader();
+  int find(std::string_view id) const;
+
+  Reader(const Reader &) = delete;
+  Reader &operator=(const Reader &) = delete;
+  Reader &operator=(Reader &&) = delete;
+
+private:
+  friend class ConcurrentNameTable;
+  Reader(ConcurrentNameTable *table, int slot);
+
+  ConcurrentNameTable *m_table;
+  int m_slot;
+};
+
+#endif // CONCURRENTNAMETABLE_INCLUDED
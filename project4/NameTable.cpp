@@ -1,151 +1,107 @@
 #include "NameTable.h"
-#include <cstdint>
-#include <functional>
-#include <list>
-#include <stack>
+#include "NameTableEngine.h"
+#include "NameTableIndex.h"
 #include <string>
-#include <vector>
-
-class NameTableImpl {
-public:
-  NameTableImpl();
-  ~NameTableImpl();
-  void enterScope();
-  bool exitScope();
-  bool declare(const std::string &id, int line_num);
-  int find(const std::string &id) const;
-  // Prevent a NameTable object from being copied, assigned, or moved
-  NameTableImpl(const NameTableImpl &) = delete;
-  NameTableImpl &operator=(const NameTableImpl &) = delete;
-  NameTableImpl(NameTableImpl &&) = delete;
-  NameTableImpl &operator=(NameTableImpl &&) = delete;
-
-private:
-  struct IdentifierData;
-  static size_t calculate_hash(const std::string &identifier);
-  static bool same_ids(const IdentifierData &id_1, const IdentifierData &id_2);
-
-  struct IdentifierData {
-    std::string identifier;
-    int line;
-    int scope;
-  };
-
-  int m_scope;
-  std::stack<IdentifierData>
-      m_active_ids; // Identifiers that have not gone out of scope
-  std::vector<std::vector<IdentifierData>> m_hash_table;
-};
-
-const int HASH_TABLE_SIZE = 20000;
-
-NameTableImpl::NameTableImpl()
-    : m_scope{0}, m_hash_table{HASH_TABLE_SIZE, std::vector<IdentifierData>{}} {
-}
-
-NameTableImpl::~NameTableImpl() {}
-
-void NameTableImpl::enterScope() { m_scope++; }
+#include <string_view>
 
-bool NameTableImpl::exitScope() {
-  if (m_scope == 0) {
-    return false;
-  }
+#ifdef NAMETABLE_COUNT_COMPARES
+long long nameTableSlotProbes = 0;
+long long nameTableKeyCompares = 0;
+#endif
 
-  // Erase identifiers that go out of scope
-  while (!m_active_ids.empty()) {
-    auto current_id = m_active_ids.top();
+// Which index from NameTableIndex.h NameTable uses. Define NAMETABLE_INDEX
+// when compiling this file to try another.
+#ifndef NAMETABLE_INDEX
+#define NAMETABLE_INDEX OpenAddressingIndex
+#endif
 
-    // Only erase identifiers in the current scope
-    if (current_id.scope != m_scope) {
-      break;
-    }
+class NameTableImpl : public NameTableEngine<NAMETABLE_INDEX> {};
 
-    size_t hash_value{calculate_hash(current_id.identifier)};
+//*********** NameTableSnapshot functions **************
 
-    // Erase the out-of-scope identifier in a hash bucket
-    auto &hash_bucket{m_hash_table.at(hash_value)};
-    for (auto it_2 = hash_bucket.begin(); it_2 != hash_bucket.end(); it_2++) {
-      if (same_ids(current_id, *it_2)) {
-        hash_bucket.erase(it_2);
-        break;
-      }
-    }
+NameTableSnapshot::NameTableSnapshot() : m_owner{nullptr}, m_node{nullptr} {}
 
-    m_active_ids.pop();
-  }
+NameTableSnapshot::NameTableSnapshot(const NameTableSnapshot &other)
+    : m_owner{other.m_owner}, m_node{other.m_node} {
+  Node::acquire(m_node);
+}
 
-  m_scope--;
-  return true;
+NameTableSnapshot &NameTableSnapshot::operator=(const NameTableSnapshot &rhs) {
+  Node::acquire(rhs.m_node);
+  Node::release(m_node);
+  m_owner = rhs.m_owner;
+  m_node = rhs.m_node;
+  return *this;
 }
 
-bool NameTableImpl::declare(const std::string &id, int line_num) {
-  if (id.empty()) {
-    return false;
-  }
+NameTableSnapshot::~NameTableSnapshot() { Node::release(m_node); }
 
-  IdentifierData id_data{id, line_num, m_scope};
-  size_t hash_value = calculate_hash(id);
+//*********** NameTable functions **************
 
-  // Check for already existing declarations in the same scope
-  auto hash_bucket = m_hash_table.at(hash_value);
-  for (const auto &identifier : hash_bucket) {
-    if (identifier.identifier == id && identifier.scope == m_scope) {
-      return false;
-    }
-  }
+// For the most part, these functions simply delegate to NameTableImpl's
+// functions.
 
-  m_active_ids.push(id_data);
-  m_hash_table.at(hash_value).push_back(id_data);
+NameTable::NameTable() : m_impl{new NameTableImpl} {}
 
-  return true;
-}
+NameTable::~NameTable() { delete m_impl; }
 
-int NameTableImpl::find(const std::string &id) const {
-  if (id.empty()) {
-    return -1;
-  }
+void NameTable::enterScope() { m_impl->enterScope(); }
 
-  IdentifierData candidate{id, 0, m_scope};
+bool NameTable::exitScope() { return m_impl->exitScope(); }
 
-  int closest_scope{-1};
-  int line{-1};
-  size_t hash_value{calculate_hash(id)};
+bool NameTable::declare(const std::string &id, int lineNum) {
+  return declare(std::string_view{id}, lineNum);
+}
 
-  for (const auto &id_data : m_hash_table.at(hash_value)) {
-    if (same_ids(id_data, candidate) && id_data.scope > closest_scope) {
-      closest_scope = id_data.scope;
-      line = id_data.line;
-    }
-  }
+int NameTable::find(const std::string &id) const {
+  return find(std::string_view{id});
+}
 
-  return line;
+bool NameTable::declare(std::string_view id, int lineNum) {
+  return !id.empty() && m_impl->declare(m_impl->intern(id), lineNum);
 }
 
-size_t NameTableImpl::calculate_hash(const std::string &identifier) {
-  return std::hash<std::string>{}(identifier) % HASH_TABLE_SIZE;
+int NameTable::find(std::string_view id) const { return m_impl->find(id); }
+
+bool NameTable::declare(const char *id, int lineNum) {
+  return id != nullptr && declare(std::string_view{id}, lineNum);
 }
 
-bool NameTableImpl::same_ids(const IdentifierData &id_1,
-                             const IdentifierData &id_2) {
-  return id_1.identifier == id_2.identifier && id_1.scope <= id_2.scope;
+int NameTable::find(const char *id) const {
+  return id == nullptr ? -1 : find(std::string_view{id});
 }
 
-//*********** NameTable functions **************
+SymbolId NameTable::intern(std::string_view id) { return m_impl->intern(id); }
 
-// For the most part, these functions simply delegate to NameTableImpl's
-// functions.
+bool NameTable::declare(SymbolId id, int lineNum) {
+  return m_impl->declare(id, lineNum);
+}
 
-NameTable::NameTable() : m_impl{new NameTableImpl} {}
+int NameTable::find(SymbolId id) const { return m_impl->find(id); }
 
-NameTable::~NameTable() { delete m_impl; }
+void NameTable::declareBatch(
+    const std::pair<std::string_view, int> *declarations, std::size_t count,
+    bool *results) {
+  m_impl->declareBatch(declarations, count, results);
+}
 
-void NameTable::enterScope() { m_impl->enterScope(); }
+void NameTable::findBatch(const std::string_view *ids, std::size_t count,
+                          int *lines) const {
+  m_impl->findBatch(ids, count, lines);
+}
 
-bool NameTable::exitScope() { return m_impl->exitScope(); }
+void NameTable::enableNegativeFilter(std::size_t counters) {
+  m_impl->enableNegativeFilter(counters);
+}
 
-bool NameTable::declare(const std::string &id, int lineNum) {
-  return m_impl->declare(id, lineNum);
+NameTableFilterStats NameTable::filterStats() const {
+  return m_impl->filterStats();
 }
 
-int NameTable::find(const std::string &id) const { return m_impl->find(id); }
+NameTableStats NameTable::stats() const { return m_impl->stats(); }
+
+NameTableSnapshot NameTable::snapshot() { return m_impl->snapshot(); }
+
+bool NameTable::restore(const NameTableSnapshot &s) {
+  return m_impl->restore(s);
+}
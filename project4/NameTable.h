@@ -1,10 +1,83 @@
 #ifndef NAMETABLE_INCLUDED
 #define NAMETABLE_INCLUDED
 
+#include <cstddef>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 class NameTableImpl;
 
+  // A dense handle for an identifier, obtained from NameTable::intern.  Each
+  // distinct identifier gets the next unused id, starting from 0.
+using SymbolId = int;
+
+  // Counters for the negative-lookup filter.  Every find by name that the
+  // filter sees is a query.  A definite miss is a query the filter answered
+  // without touching the table; a false positive is a query the filter let
+  // through that the table then found no declaration for.
+struct NameTableFilterStats
+{
+    long long queries;
+    long long definiteMisses;
+    long long falsePositives;
+};
+
+  // A picture of a NameTable's contents and history, from NameTable::stats.
+  // The structural figures are computed when stats is called.  The operation
+  // counters are kept as the table runs; they cost one increment per call and
+  // can be compiled out by defining NAMETABLE_NO_STATS when building
+  // NameTable.cpp, in which case countersEnabled is false and they are 0.
+struct NameTableStats
+{
+    long long liveDeclarations;     // Declarations currently in scope
+    int scopeDepth;                 // Scopes open besides the global scope
+    long long symbols;              // Distinct identifiers ever interned
+    std::size_t slots;              // Hash table capacity
+    double loadFactor;              // symbols / slots
+      // probeLengths[k] is how many symbols sit k slots past their home
+      // slot, so a successful lookup of one of them probes k+1 slots.
+      // slots, loadFactor and probeLengths are 0 or empty for indexes that
+      // are not hash tables.
+    std::vector<long long> probeLengths;
+    int maxShadowDepth;             // Most declarations of one identifier
+                                    // in scope at once
+      // Bytes held by the table's own arrays, not counting snapshots.  The
+      // peak includes the moment a growing hash table holds both its old and
+      // new slots.
+    std::size_t bytesAllocated;
+    std::size_t peakBytesAllocated;
+
+    bool countersEnabled;
+    long long declares;
+    long long declareFailures;      // Duplicate in scope, or invalid id
+    long long finds;
+    long long findHits;             // Finds that returned a line number
+    long long exitScopes;
+    long long exitScopeFailures;    // Attempts to exit the global scope
+};
+
+  // A saved state of a NameTable, from NameTable::snapshot.  Snapshots are
+  // cheap to copy and share their storage with each other and with the table,
+  // so holding many of them costs memory only for how much they differ.  A
+  // snapshot remains usable after it has been restored and after the table
+  // has moved on, but only with the table that made it.
+class NameTableSnapshot
+{
+  public:
+    NameTableSnapshot();
+    NameTableSnapshot(const NameTableSnapshot& other);
+    NameTableSnapshot& operator=(const NameTableSnapshot& rhs);
+    ~NameTableSnapshot();
+
+  private:
+    template <typename Index> friend class NameTableEngine;
+    struct Node;
+    const void* m_owner;
+    Node* m_node;
+};
+
 class NameTable
 {
   public:
@@ -14,6 +87,46 @@ class NameTable
     bool exitScope();
     bool declare(const std::string& id, int lineNum);
     int find(const std::string& id) const;
+      // The same operations, for callers that hold a view or a C string
+      // rather than a std::string
+    bool declare(std::string_view id, int lineNum);
+    int find(std::string_view id) const;
+    bool declare(const char* id, int lineNum);
+    int find(const char* id) const;
+      // Return the SymbolId for id, or -1 if id is empty.  A caller that
+      // repeatedly refers to the same identifier can intern it once and then
+      // use the SymbolId overloads, which skip hashing entirely.  Interning
+      // does not declare anything.
+    SymbolId intern(std::string_view id);
+    bool declare(SymbolId id, int lineNum);
+    int find(SymbolId id) const;
+      // Declare or look up count identifiers in one call.  declareBatch
+      // makes declarations[0], declarations[1], ... in order, each a pair of
+      // identifier and line number, exactly as that many calls to declare
+      // would; if results is not null, results[k] is set to what declare
+      // would have returned for declarations[k].  findBatch sets lines[k]
+      // to find(ids[k]).  A batch hashes its identifiers a few at a time and
+      // fetches their table entries together, so for more than a handful of
+      // identifiers it is faster than the equivalent single calls.
+    void declareBatch(const std::pair<std::string_view, int>* declarations,
+                      std::size_t count, bool* results = nullptr);
+    void findBatch(const std::string_view* ids, std::size_t count,
+                   int* lines) const;
+      // Put a counting Bloom filter with the given number of counters
+      // (rounded up to a power of two) in front of find, so that lookups of
+      // names with no declaration in scope can usually be rejected without
+      // probing the table.  Passing 0 removes the filter.  The filter is off
+      // by default.
+    void enableNegativeFilter(std::size_t counters);
+    NameTableFilterStats filterStats() const;
+    NameTableStats stats() const;
+      // Save the current scopes and declarations, and later return to them.
+      // Restoring costs time proportional to how far the table has moved
+      // from the snapshot.  restore returns false, leaving the table
+      // unchanged, if the snapshot did not come from this table.  SymbolIds
+      // interned since the snapshot remain valid.
+    NameTableSnapshot snapshot();
+    bool restore(const NameTableSnapshot& s);
       // We prevent a NameTable object from being copied or assigned
     NameTable(const NameTable&) = delete;
     NameTable& operator=(const NameTable&) = delete;
@@ -0,0 +1,789 @@
+// NameTableEngine.h
+
+#ifndef NAMETABLEENGINE_INCLUDED
+#define NAMETABLEENGINE_INCLUDED
+
+#include "NameTable.h"
+#include "NameTableIndex.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The operation counters behind NameTable::stats cost one increment per call.
+// Define NAMETABLE_NO_STATS to compile them out.
+#ifdef NAMETABLE_NO_STATS
+#define NAMETABLE_COUNT(counter) ((void)0)
+#else
+#define NAMETABLE_COUNT(counter) (m_counters.counter++)
+#endif
+
+// The scope machinery behind NameTable, parameterized on how identifiers are
+// looked up. `Index` is one of the indexes in NameTableIndex.h; NameTable.cpp
+// picks one for NameTable, and benchIndexes.cpp compares them all.
+template <typename Index> class NameTableEngine {
+public:
+  NameTableEngine();
+  ~NameTableEngine();
+  void enterScope();
+  bool exitScope();
+  SymbolId intern(std::string_view id);
+  bool declare(SymbolId symbol, int line_num);
+  int find(std::string_view id) const;
+  int find(SymbolId symbol) const;
+  void declareBatch(const std::pair<std::string_view, int> *declarations,
+                    size_t count, bool *results);
+  void findBatch(const std::string_view *ids, size_t count, int *lines) const;
+  void enableNegativeFilter(size_t counters);
+  NameTableFilterStats filterStats() const;
+  NameTableStats stats() const;
+  NameTableSnapshot snapshot();
+  bool restore(const NameTableSnapshot &snapshot);
+  // Prevent a NameTable object from being copied, assigned, or moved
+  NameTableEngine(const NameTableEngine &) = delete;
+  NameTableEngine &operator=(const NameTableEngine &) = delete;
+  NameTableEngine(NameTableEngine &&) = delete;
+  NameTableEngine &operator=(NameTableEngine &&) = delete;
+
+private:
+  using SnapshotNode = NameTableSnapshot::Node;
+  struct Declaration;
+  struct Symbol;
+  struct Key;
+  using Hash = NameTableHash;
+
+  // Identifiers up to this long are stored inside their symbol
+  static constexpr size_t INLINE_KEY_CAPACITY = 20;
+
+  static Hash calculate_hash(std::string_view identifier);
+
+  Key make_key(std::string_view identifier);
+  const char *key_data(const Key &key) const;
+  std::string_view identifier_of(SymbolId symbol) const;
+  bool valid_symbol(SymbolId symbol) const;
+  SymbolId intern(std::string_view id, Hash hash);
+  int find_line(std::string_view id, Hash hash) const;
+  int line_of(SymbolId symbol) const;
+  int count_find(int line) const;
+  size_t bytes_allocated() const;
+  SymbolId find_symbol(std::string_view identifier, Hash hash) const;
+  void insert(SymbolId symbol, std::string_view identifier, Hash hash);
+  size_t filter_index(Hash hash, int probe) const;
+  void filter_add(Hash hash);
+  void filter_remove(Hash hash);
+  bool filter_may_contain(Hash hash) const;
+  int live_innermost(SymbolId symbol) const;
+  void unlink_dead(SymbolId symbol);
+  void retire(int index);
+  void clean_step();
+  void push_declaration(SymbolId symbol, int line_num);
+  void pop_to(int declarations, int scopes);
+  void freeze();
+  void set_frozen(SnapshotNode *node);
+
+  // One declaration of a symbol. Declarations live in a single stack in the
+  // order they were made, and each one links to the declaration of the same
+  // symbol that it shadows, so a symbol's shadow stack is threaded through
+  // that one array instead of owning a vector of its own.
+  //
+  // The stack doubles as a bump allocator for scopes: the declarations of each
+  // open scope occupy one contiguous region that starts at the matching entry
+  // of `m_scope_starts`, so a declaration's scope is implied by its position.
+  //
+  // Closing a scope only lowers `m_live`. The declarations above it are dead,
+  // but symbols may still point at them, so every lookup skips down a shadow
+  // stack past dead entries, and dead entries are unlinked a few at a time
+  // by later operations, or just before their space is reused.
+  struct Declaration {
+    SymbolId symbol;
+    int line;
+    int shadowed; // Index into `m_active_ids`, or -1 if nothing is shadowed
+  };
+
+  // An identifier in a fixed 24 bytes. Short identifiers, which are nearly
+  // all of them, are stored in place; a longer one is appended to
+  // `m_long_keys` and `chars` holds its offset there instead.
+  struct Key {
+    char chars[INLINE_KEY_CAPACITY];
+    uint32_t length;
+  };
+
+  // Every distinct identifier ever declared gets one `Symbol`. A symbol whose
+  // declarations have all gone out of scope stays in the table so that
+  // redeclaring it later does not need to insert again.
+  struct Symbol {
+    Key key;
+    Hash hash;
+    int innermost; // Index into `m_active_ids`, or -1 if not in scope. May
+                   // be dead; see `live_innermost()`.
+  };
+  static_assert(std::is_trivially_copyable<Symbol>::value,
+                "Symbols should be plain data");
+
+  std::vector<Declaration> m_active_ids;
+  int m_live;      // Declarations below this index are in scope
+  int m_dirty_end; // Dead declarations from `m_live` up to this index may
+                   // still be linked from their symbols; those above it are
+                   // not, and their space is free
+  std::vector<int> m_scope_starts; // Where each open scope's region begins in
+                                   // `m_active_ids`, starting with the global
+                                   // scope
+  std::vector<Symbol> m_symbols;
+  std::vector<char> m_long_keys; // Identifiers too long to store inline
+  Index m_index;
+
+  // The latest snapshot node whose history is a prefix of the current state's,
+  // or nullptr. Everything after it has not been recorded in snapshot nodes
+  // yet; `snapshot()` records it on demand.
+  SnapshotNode *m_frozen;
+
+  // How far the current state has been popped back since `m_frozen` was set.
+  // Only the part of the frozen history within these counts is still current.
+  int m_frozen_valid_declarations;
+  int m_frozen_valid_scopes;
+
+  // Counting Bloom filter over the identifiers of live declarations. Empty when
+  // the filter is disabled.
+  std::vector<uint8_t> m_filter;
+  mutable NameTableFilterStats m_filter_stats;
+
+  struct Counters {
+    long long declares;
+    long long declare_failures;
+    long long finds;
+    long long find_hits;
+    long long exit_scopes;
+    long long exit_scope_failures;
+  };
+  mutable Counters m_counters;
+  size_t m_peak_bytes; // Highest `bytes_allocated()` seen while growing
+};
+
+// Dead declarations unlinked by each operation, so that the work of closing a
+// scope is spread over the operations that follow it
+const int CLEAN_STEPS = 2;
+
+// Identifiers that a batch operation hashes and prefetches before using any
+// of them: enough to keep several cache misses in flight, few enough that the
+// prefetched lines are still cached when their turn comes
+const size_t BATCH_ROUND = 16;
+
+// Smaller batches than this gain too little overlap to pay for the extra
+// passes, so they are handled one identifier at a time
+const size_t MIN_PREFETCHED_BATCH = 4;
+
+// Each identifier sets this many counters in the negative-lookup filter
+const int FILTER_PROBES = 2;
+
+// A counter that reaches this value is stuck there, since it can no longer
+// tell how many identifiers share it
+const uint8_t FILTER_COUNTER_MAX = UINT8_MAX;
+
+// Snapshots are persistent: each node records one event, either entering a
+// scope or making a declaration, and points to the node for the event before
+// it. A state is the path from a node back to the root, so states that share
+// a history share nodes, and a snapshot is just a counted reference to a node.
+// An empty history is a null node.
+struct NameTableSnapshot::Node {
+  Node *parent;
+  int refs;
+  int declarations; // Declarations in the history up to and including this
+  int scopes;       // Scopes entered in the history up to and including this
+  SymbolId symbol;  // -1 if this event entered a scope
+  int line;
+
+  int depth() const { return declarations + scopes; }
+
+  static void acquire(Node *node) {
+    if (node != nullptr) {
+      node->refs++;
+    }
+  }
+
+  // Iterative, so that dropping a long history cannot overflow the stack
+  static void release(Node *node) {
+    while (node != nullptr && --node->refs == 0) {
+      Node *parent = node->parent;
+      delete node;
+      node = parent;
+    }
+  }
+};
+
+template <typename Index>
+NameTableEngine<Index>::NameTableEngine()
+    : m_live{0}, m_dirty_end{0}, m_scope_starts{0},
+      m_frozen{nullptr},
+      m_frozen_valid_declarations{INT_MAX}, m_frozen_valid_scopes{INT_MAX},
+      m_filter_stats{0, 0, 0}, m_counters{}, m_peak_bytes{0} {}
+
+template <typename Index>
+NameTableEngine<Index>::~NameTableEngine() { SnapshotNode::release(m_frozen); }
+
+template <typename Index>
+void NameTableEngine<Index>::enterScope() {
+  clean_step();
+  m_scope_starts.push_back(m_live);
+}
+
+template <typename Index>
+bool NameTableEngine<Index>::exitScope() {
+  NAMETABLE_COUNT(exit_scopes);
+
+  // The global scope can never be exited
+  if (m_scope_starts.size() == 1) {
+    NAMETABLE_COUNT(exit_scope_failures);
+    return false;
+  }
+
+  pop_to(m_scope_starts.back(), static_cast<int>(m_scope_starts.size()) - 2);
+  clean_step();
+  return true;
+}
+
+template <typename Index>
+SymbolId NameTableEngine<Index>::intern(std::string_view id) {
+  if (id.empty()) {
+    return -1;
+  }
+
+  return intern(id, calculate_hash(id));
+}
+
+template <typename Index>
+SymbolId NameTableEngine<Index>::intern(std::string_view id, Hash hash_value) {
+  SymbolId symbol = find_symbol(id, hash_value);
+
+  if (symbol == -1) {
+    symbol = static_cast<SymbolId>(m_symbols.size());
+    m_symbols.push_back(Symbol{make_key(id), hash_value, -1});
+    insert(symbol, id, hash_value);
+  }
+
+  return symbol;
+}
+
+template <typename Index>
+bool NameTableEngine<Index>::declare(SymbolId symbol, int line_num) {
+  NAMETABLE_COUNT(declares);
+  if (!valid_symbol(symbol)) {
+    NAMETABLE_COUNT(declare_failures);
+    return false;
+  }
+
+  clean_step();
+  unlink_dead(symbol);
+
+  // Check for an already existing declaration in the same scope, i.e. one
+  // inside the current scope's region
+  if (m_symbols[symbol].innermost >= m_scope_starts.back()) {
+    NAMETABLE_COUNT(declare_failures);
+    return false;
+  }
+
+  push_declaration(symbol, line_num);
+  return true;
+}
+
+template <typename Index>
+int NameTableEngine<Index>::find(std::string_view id) const {
+  return count_find(find_line(id, calculate_hash(id)));
+}
+
+template <typename Index>
+int NameTableEngine<Index>::find(SymbolId symbol) const {
+  return count_find(line_of(symbol));
+}
+
+// Batches work in rounds: hash every identifier in the round and prefetch
+// where its lookup starts, then look each one up in order. By the time a
+// lookup needs its slot, the load has usually finished in the background.
+template <typename Index>
+void NameTableEngine<Index>::declareBatch(
+    const std::pair<std::string_view, int> *declarations, size_t count,
+    bool *results) {
+  if (count < MIN_PREFETCHED_BATCH) {
+    for (size_t k = 0; k < count; k++) {
+      const bool declared =
+          !declarations[k].first.empty() &&
+          declare(intern(declarations[k].first), declarations[k].second);
+      if (results != nullptr) {
+        results[k] = declared;
+      }
+    }
+    return;
+  }
+
+  Hash hashes[BATCH_ROUND];
+  for (size_t start = 0; start < count; start += BATCH_ROUND) {
+    const size_t round = std::min(BATCH_ROUND, count - start);
+    for (size_t k = 0; k < round; k++) {
+      hashes[k] = calculate_hash(declarations[start + k].first);
+      m_index.prefetch(hashes[k]);
+    }
+
+    for (size_t k = 0; k < round; k++) {
+      const std::pair<std::string_view, int> &declaration =
+          declarations[start + k];
+      const bool declared =
+          !declaration.first.empty() &&
+          declare(intern(declaration.first, hashes[k]), declaration.second);
+      if (results != nullptr) {
+        results[start + k] = declared;
+      }
+    }
+  }
+}
+
+// Finds take a second pass per round so that the declarations the symbols
+// point at are prefetched too. Each line is what `find(ids[k])` would return,
+// and the counters and filter statistics move just as they would.
+template <typename Index>
+void NameTableEngine<Index>::findBatch(const std::string_view *ids,
+                                       size_t count, int *lines) const {
+  if (count < MIN_PREFETCHED_BATCH) {
+    for (size_t k = 0; k < count; k++) {
+      lines[k] = find(ids[k]);
+    }
+    return;
+  }
+
+  Hash hashes[BATCH_ROUND];
+  SymbolId symbols[BATCH_ROUND];
+  bool passed_filter[BATCH_ROUND];
+  for (size_t start = 0; start < count; start += BATCH_ROUND) {
+    const size_t round = std::min(BATCH_ROUND, count - start);
+    for (size_t k = 0; k < round; k++) {
+      hashes[k] = calculate_hash(ids[start + k]);
+      m_index.prefetch(hashes[k]);
+    }
+
+    for (size_t k = 0; k < round; k++) {
+      const std::string_view id = ids[start + k];
+      symbols[k] = -1;
+      passed_filter[k] = false;
+      if (id.empty()) {
+        continue;
+      }
+      if (!m_filter.empty()) {
+        m_filter_stats.queries++;
+        if (!filter_may_contain(hashes[k])) {
+          m_filter_stats.definiteMisses++;
+          continue;
+        }
+        passed_filter[k] = true;
+      }
+      symbols[k] = find_symbol(id, hashes[k]);
+      if (symbols[k] != -1 && m_symbols[symbols[k]].innermost != -1) {
+        NAMETABLE_PREFETCH(&m_active_ids[m_symbols[symbols[k]].innermost]);
+      }
+    }
+
+    for (size_t k = 0; k < round; k++) {
+      const int line = line_of(symbols[k]);
+      if (line == -1 && passed_filter[k]) {
+        m_filter_stats.falsePositives++;
+      }
+      lines[start + k] = count_find(line);
+    }
+  }
+}
+
+template <typename Index>
+int NameTableEngine<Index>::find_line(std::string_view id,
+                                      Hash hash_value) const {
+  if (id.empty()) {
+    return -1;
+  }
+
+  if (m_filter.empty()) {
+    return line_of(find_symbol(id, hash_value));
+  }
+
+  m_filter_stats.queries++;
+  if (!filter_may_contain(hash_value)) {
+    m_filter_stats.definiteMisses++;
+    return -1;
+  }
+
+  const int line = line_of(find_symbol(id, hash_value));
+  if (line == -1) {
+    m_filter_stats.falsePositives++;
+  }
+  return line;
+}
+
+template <typename Index>
+int NameTableEngine<Index>::line_of(SymbolId symbol) const {
+  if (!valid_symbol(symbol)) {
+    return -1;
+  }
+
+  const int innermost = live_innermost(symbol);
+  return innermost == -1 ? -1 : m_active_ids[innermost].line;
+}
+
+template <typename Index>
+int NameTableEngine<Index>::count_find(int line) const {
+  NAMETABLE_COUNT(finds);
+  if (line != -1) {
+    NAMETABLE_COUNT(find_hits);
+  }
+  return line;
+}
+
+template <typename Index>
+NameTableHash NameTableEngine<Index>::calculate_hash(std::string_view identifier) {
+  return hash_identifier(identifier);
+}
+
+template <typename Index>
+typename NameTableEngine<Index>::Key NameTableEngine<Index>::make_key(std::string_view identifier) {
+  Key key{};
+  key.length = static_cast<uint32_t>(identifier.size());
+  if (identifier.size() <= INLINE_KEY_CAPACITY) {
+    std::memcpy(key.chars, identifier.data(), identifier.size());
+  } else {
+    const auto offset = static_cast<uint32_t>(m_long_keys.size());
+    std::memcpy(key.chars, &offset, sizeof(offset));
+    m_long_keys.insert(m_long_keys.end(), identifier.begin(), identifier.end());
+  }
+  return key;
+}
+
+template <typename Index>
+const char *NameTableEngine<Index>::key_data(const Key &key) const {
+  if (key.length <= INLINE_KEY_CAPACITY) {
+    return key.chars;
+  }
+  uint32_t offset;
+  std::memcpy(&offset, key.chars, sizeof(offset));
+  return m_long_keys.data() + offset;
+}
+
+template <typename Index>
+std::string_view NameTableEngine<Index>::identifier_of(SymbolId symbol) const {
+  const Key &key = m_symbols[symbol].key;
+  return std::string_view{key_data(key), key.length};
+}
+
+// Returns the symbol for `identifier`, or -1 if it has never been interned
+template <typename Index>
+SymbolId NameTableEngine<Index>::find_symbol(std::string_view identifier,
+                                    Hash hash) const {
+  return m_index.find(identifier, hash, [this](SymbolId symbol) {
+    return identifier_of(symbol);
+  });
+}
+
+template <typename Index>
+void NameTableEngine<Index>::insert(SymbolId symbol, std::string_view identifier,
+                           Hash hash) {
+  const size_t replaced = m_index.insert(
+      symbol, identifier, hash,
+      [this](SymbolId other) { return identifier_of(other); });
+
+  // Storage the index replaced was alive alongside its replacement
+  if (replaced > 0) {
+    m_peak_bytes = std::max(m_peak_bytes, bytes_allocated() + replaced);
+  }
+}
+
+template <typename Index>
+bool NameTableEngine<Index>::valid_symbol(SymbolId symbol) const {
+  return symbol >= 0 && symbol < static_cast<SymbolId>(m_symbols.size());
+}
+
+template <typename Index>
+void NameTableEngine<Index>::enableNegativeFilter(size_t counters) {
+  m_filter.clear();
+  m_filter_stats = NameTableFilterStats{0, 0, 0};
+  if (counters == 0) {
+    return;
+  }
+
+  size_t size{1};
+  while (size < counters) {
+    size *= 2;
+  }
+  m_filter.assign(size, 0);
+
+  // Account for everything already declared, and for the dead declarations
+  // that will be removed from the filter when they are unlinked
+  for (int i = 0; i < m_dirty_end; i++) {
+    filter_add(m_symbols[m_active_ids[i].symbol].hash);
+  }
+}
+
+template <typename Index>
+NameTableFilterStats NameTableEngine<Index>::filterStats() const {
+  return m_filter_stats;
+}
+
+template <typename Index>
+NameTableStats NameTableEngine<Index>::stats() const {
+  NameTableStats result{};
+  result.liveDeclarations = m_live;
+  result.scopeDepth = static_cast<int>(m_scope_starts.size()) - 1;
+  result.symbols = static_cast<long long>(m_symbols.size());
+  m_index.describe(result);
+
+  // A declaration shadows only earlier ones, so one pass up the stack finds
+  // every shadow depth
+  std::vector<int> shadow_depths(m_live);
+  for (int i = 0; i < m_live; i++) {
+    const int shadowed = m_active_ids[i].shadowed;
+    shadow_depths[i] = shadowed == -1 ? 1 : shadow_depths[shadowed] + 1;
+    result.maxShadowDepth = std::max(result.maxShadowDepth, shadow_depths[i]);
+  }
+
+  result.bytesAllocated = bytes_allocated();
+  result.peakBytesAllocated = std::max(m_peak_bytes, result.bytesAllocated);
+
+#ifndef NAMETABLE_NO_STATS
+  result.countersEnabled = true;
+  result.declares = m_counters.declares;
+  result.declareFailures = m_counters.declare_failures;
+  result.finds = m_counters.finds;
+  result.findHits = m_counters.find_hits;
+  result.exitScopes = m_counters.exit_scopes;
+  result.exitScopeFailures = m_counters.exit_scope_failures;
+#endif
+  return result;
+}
+
+// None of these vectors ever gives memory back, so this only grows
+template <typename Index>
+size_t NameTableEngine<Index>::bytes_allocated() const {
+  return m_active_ids.capacity() * sizeof(Declaration) +
+         m_scope_starts.capacity() * sizeof(int) +
+         m_symbols.capacity() * sizeof(Symbol) + m_long_keys.capacity() +
+         m_index.bytes() + m_filter.capacity();
+}
+
+// Derives each probe's counter from a different part of the hash, remixing so
+// that identifiers that share a hash table home slot rarely share counters
+template <typename Index>
+size_t NameTableEngine<Index>::filter_index(Hash hash, int probe) const {
+  const uint64_t mixed = (static_cast<uint64_t>(hash) + probe) *
+                         UINT64_C(0x9E3779B97F4A7C15);
+  return static_cast<size_t>(mixed >> (32 * probe)) & (m_filter.size() - 1);
+}
+
+template <typename Index>
+void NameTableEngine<Index>::filter_add(Hash hash) {
+  if (m_filter.empty()) {
+    return;
+  }
+  for (int probe = 0; probe < FILTER_PROBES; probe++) {
+    uint8_t &counter = m_filter[filter_index(hash, probe)];
+    if (counter != FILTER_COUNTER_MAX) {
+      counter++;
+    }
+  }
+}
+
+template <typename Index>
+void NameTableEngine<Index>::filter_remove(Hash hash) {
+  if (m_filter.empty()) {
+    return;
+  }
+  for (int probe = 0; probe < FILTER_PROBES; probe++) {
+    uint8_t &counter = m_filter[filter_index(hash, probe)];
+    if (counter != FILTER_COUNTER_MAX) {
+      counter--;
+    }
+  }
+}
+
+template <typename Index>
+bool NameTableEngine<Index>::filter_may_contain(Hash hash) const {
+  for (int probe = 0; probe < FILTER_PROBES; probe++) {
+    if (m_filter[filter_index(hash, probe)] == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The innermost declaration still in scope is the first live one on the
+// symbol's shadow stack. Once a shadow stack reaches a live declaration,
+// everything below it is live too, since those scopes enclose its scope.
+template <typename Index>
+int NameTableEngine<Index>::live_innermost(SymbolId symbol) const {
+  int innermost = m_symbols[symbol].innermost;
+  while (innermost >= m_live) {
+    innermost = m_active_ids[innermost].shadowed;
+  }
+  return innermost;
+}
+
+// Point the symbol past its dead declarations. Each dead declaration is
+// skipped here at most once, so this costs O(1) amortized.
+template <typename Index>
+void NameTableEngine<Index>::unlink_dead(SymbolId symbol) {
+  m_symbols[symbol].innermost = live_innermost(symbol);
+}
+
+// Unlink the dead declaration at `index` and free its space
+template <typename Index>
+void NameTableEngine<Index>::retire(int index) {
+  const Declaration &dead = m_active_ids[index];
+  unlink_dead(dead.symbol);
+  filter_remove(m_symbols[dead.symbol].hash);
+}
+
+// Retire a few dead declarations from the top of the dirty region, so that
+// lookups soon stop having to skip them
+template <typename Index>
+void NameTableEngine<Index>::clean_step() {
+  for (int step = 0; step < CLEAN_STEPS && m_dirty_end > m_live; step++) {
+    m_dirty_end--;
+    retire(m_dirty_end);
+  }
+}
+
+template <typename Index>
+void NameTableEngine<Index>::push_declaration(SymbolId symbol, int line_num) {
+  if (m_live < m_dirty_end) {
+    retire(m_live);
+  }
+  unlink_dead(symbol);
+
+  Symbol &data = m_symbols[symbol];
+  const Declaration declaration{symbol, line_num, data.innermost};
+  if (m_live == static_cast<int>(m_active_ids.size())) {
+    m_active_ids.push_back(declaration);
+  } else {
+    m_active_ids[m_live] = declaration;
+  }
+  data.innermost = m_live;
+  m_live++;
+  m_dirty_end = std::max(m_dirty_end, m_live);
+  filter_add(data.hash);
+}
+
+// Close scopes until only `scopes` are open besides the global scope, and pop
+// declarations until only `declarations` remain. The declarations popped must
+// be exactly those of the closed scopes, or of the innermost remaining scope.
+// This takes constant time: the popped declarations are left in place for
+// lookups to skip and for later operations to unlink.
+template <typename Index>
+void NameTableEngine<Index>::pop_to(int declarations, int scopes) {
+  m_live = declarations;
+  m_scope_starts.resize(scopes + 1);
+
+  // The frozen history may include events that were just popped
+  m_frozen_valid_declarations =
+      std::min(m_frozen_valid_declarations, declarations);
+  m_frozen_valid_scopes = std::min(m_frozen_valid_scopes, scopes);
+}
+
+template <typename Index>
+void NameTableEngine<Index>::set_frozen(SnapshotNode *node) {
+  SnapshotNode::acquire(node);
+  SnapshotNode::release(m_frozen);
+  m_frozen = node;
+  m_frozen_valid_declarations = INT_MAX;
+  m_frozen_valid_scopes = INT_MAX;
+}
+
+// Record every event since the frozen node, so that `m_frozen` describes the
+// whole current state. A scope's entry event comes before the first
+// declaration made in it.
+template <typename Index>
+void NameTableEngine<Index>::freeze() {
+  // Drop the frozen events that have since been popped
+  SnapshotNode *frozen = m_frozen;
+  while (frozen != nullptr &&
+         (frozen->declarations > m_frozen_valid_declarations ||
+          frozen->scopes > m_frozen_valid_scopes)) {
+    frozen = frozen->parent;
+  }
+  set_frozen(frozen);
+
+  int declarations = m_frozen == nullptr ? 0 : m_frozen->declarations;
+  int scopes = m_frozen == nullptr ? 0 : m_frozen->scopes;
+  const int total_scopes = static_cast<int>(m_scope_starts.size()) - 1;
+  const int total_declarations = m_live;
+
+  SnapshotNode *node = m_frozen;
+  SnapshotNode::acquire(node);
+  while (declarations < total_declarations || scopes < total_scopes) {
+    auto *event = new SnapshotNode{node, 1, declarations, scopes, -1,
+                                              0}; // Takes over our reference
+    if (scopes < total_scopes && m_scope_starts[scopes + 1] <= declarations) {
+      scopes++;
+    } else {
+      event->symbol = m_active_ids[declarations].symbol;
+      event->line = m_active_ids[declarations].line;
+      declarations++;
+    }
+    event->declarations = declarations;
+    event->scopes = scopes;
+    node = event;
+  }
+
+  set_frozen(node);
+  SnapshotNode::release(node);
+}
+
+template <typename Index>
+NameTableSnapshot NameTableEngine<Index>::snapshot() {
+  freeze();
+
+  NameTableSnapshot result;
+  result.m_owner = this;
+  result.m_node = m_frozen;
+  SnapshotNode::acquire(m_frozen);
+  return result;
+}
+
+template <typename Index>
+bool NameTableEngine<Index>::restore(const NameTableSnapshot &snapshot) {
+  if (snapshot.m_owner != this) {
+    return false;
+  }
+
+  freeze();
+
+  // Find the most recent event the two histories share
+  SnapshotNode *current = m_frozen;
+  SnapshotNode *target = snapshot.m_node;
+  std::vector<SnapshotNode *> replay;
+  while (current != target) {
+    const int current_depth = current == nullptr ? 0 : current->depth();
+    const int target_depth = target == nullptr ? 0 : target->depth();
+    if (current_depth >= target_depth) {
+      current = current->parent;
+    }
+    if (target_depth >= current_depth) {
+      replay.push_back(target);
+      target = target->parent;
+    }
+  }
+
+  // Undo everything after the shared event, then redo the snapshot's events
+  if (current == nullptr) {
+    pop_to(0, 0);
+  } else {
+    pop_to(current->declarations, current->scopes);
+  }
+  for (auto it = replay.rbegin(); it != replay.rend(); it++) {
+    if ((*it)->symbol == -1) {
+      enterScope();
+    } else {
+      push_declaration((*it)->symbol, (*it)->line);
+    }
+  }
+
+  set_frozen(snapshot.m_node);
+  return true;
+}
+
+#endif // NAMETABLEENGINE_INCLUDED
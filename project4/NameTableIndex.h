@@ -0,0 +1,492 @@
+// NameTableIndex.h
+
+// Interchangeable indexes from identifiers to symbols, for NameTableEngine.
+//
+// Every index has the same members:
+//
+//   template <typename KeyOf>
+//   SymbolId find(std::string_view identifier, NameTableHash hash,
+//                 const KeyOf &key_of) const;
+//     Returns the symbol whose identifier is `identifier`, or -1 if it has
+//     never been inserted.  `key_of(symbol)` returns a symbol's identifier
+//     as a std::string_view.
+//
+//   template <typename KeyOf>
+//   size_t insert(SymbolId symbol, std::string_view identifier,
+//                 NameTableHash hash, const KeyOf &key_of);
+//     Adds a symbol that is not in the index yet.  Symbols are inserted in
+//     order: 0, 1, 2, ...  Returns the size in bytes of any storage the
+//     insertion replaced, which was alive alongside its replacement.
+//
+//   void prefetch(NameTableHash hash) const;
+//     Starts loading whatever a lookup of an identifier with this hash will
+//     touch first, so that a batch of lookups can overlap their cache misses.
+//     It may do nothing.
+//
+//   size_t bytes() const;
+//   void describe(NameTableStats &stats) const;
+//     Report memory use, and fill in the slots, loadFactor and probeLengths
+//     fields of `stats`.
+//
+//   static const char *name();
+
+#ifndef NAMETABLEINDEX_INCLUDED
+#define NAMETABLEINDEX_INCLUDED
+
+#include "NameTable.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// Compare short keys 16 bytes at a time. Address sanitizers object to the
+// over-long loads this relies on, so they get the portable comparison.
+#if defined(__SSE2__) && !defined(__SANITIZE_ADDRESS__)
+#define NAMETABLE_SIMD_COMPARE
+#endif
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#undef NAMETABLE_SIMD_COMPARE
+#endif
+#endif
+
+#ifdef NAMETABLE_SIMD_COMPARE
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NAMETABLE_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define NAMETABLE_PREFETCH(address) ((void)(address))
+#endif
+
+// With NAMETABLE_COUNT_COMPARES defined, every lookup by name in an
+// OpenAddressingIndex counts the occupied slots it probes and the identifiers
+// it actually compares, for benchCompares.cpp. NameTable.cpp defines them.
+#ifdef NAMETABLE_COUNT_COMPARES
+extern long long nameTableSlotProbes;
+extern long long nameTableKeyCompares;
+#endif
+
+// Hashes are kept to 32 bits, which is plenty to index any table that fits in
+// memory and keeps slots small
+using NameTableHash = uint32_t;
+
+// The hash of an identifier, as the engine and every index see it. Exposed so
+// that fuzzNameTable.cpp can go looking for identifiers that collide.
+inline NameTableHash hash_identifier(std::string_view identifier) {
+  // Fold the high half in rather than dropping it
+  const uint64_t full = std::hash<std::string_view>{}(identifier);
+  return static_cast<NameTableHash>(full ^ (full >> 32));
+}
+
+#ifdef NAMETABLE_SIMD_COMPARE
+// Whether a 16-byte load starting at `p` stays within one page, so that
+// reading past the end of a short key cannot fault
+inline bool load_stays_in_page(const char *p) {
+  const uintptr_t PAGE_BYTES = 4096;
+  return (reinterpret_cast<uintptr_t>(p) & (PAGE_BYTES - 1)) <= PAGE_BYTES - 16;
+}
+
+inline unsigned equal_bytes(const char *a, const char *b) {
+  const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+  const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+  return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+}
+#endif
+
+// Identifiers are short (the generator's are 6 characters by default and at
+// most 20), so one or two vector compares cover almost all of them
+inline bool keys_equal(const char *a, const char *b, size_t length) {
+#ifdef NAMETABLE_SIMD_COMPARE
+  if (length <= 16 && load_stays_in_page(a) && load_stays_in_page(b)) {
+    const unsigned wanted = (1U << length) - 1;
+    return (equal_bytes(a, b) & wanted) == wanted;
+  }
+  if (length > 16 && length <= 32) {
+    // Two overlapping loads, both inside the keys
+    return equal_bytes(a, b) == 0xFFFF &&
+           equal_bytes(a + length - 16, b + length - 16) == 0xFFFF;
+  }
+#endif
+  return std::memcmp(a, b, length) == 0;
+}
+
+//========================================================================
+// OpenAddressingIndex
+//========================================================================
+
+// A hash table whose entries are stored inline in one contiguous array and
+// kept in Robin Hood order, so a probe can stop as soon as it reaches an
+// entry that is closer to its home slot than the probe is to its own. The
+// cached hash means a probe almost never has to look at a symbol whose
+// identifier does not match, and when it does, the length is checked before
+// the characters.
+class OpenAddressingIndex {
+public:
+  OpenAddressingIndex() : m_size{0}, m_slots{INITIAL_CAPACITY, Slot{0, -1}} {}
+
+  template <typename KeyOf>
+  SymbolId find(std::string_view identifier, NameTableHash hash,
+                const KeyOf &key_of) const {
+    size_t probe_distance{0};
+    for (size_t i = home(hash);; i = next(i), probe_distance++) {
+      const Slot &slot = m_slots[i];
+      if (slot.symbol == -1 || distance(i) < probe_distance) {
+        return -1;
+      }
+#ifdef NAMETABLE_COUNT_COMPARES
+      nameTableSlotProbes++;
+#endif
+      if (slot.hash != hash) {
+        continue;
+      }
+      const std::string_view candidate = key_of(slot.symbol);
+      if (candidate.size() != identifier.size()) {
+        continue;
+      }
+#ifdef NAMETABLE_COUNT_COMPARES
+      nameTableKeyCompares++;
+#endif
+      if (keys_equal(candidate.data(), identifier.data(), identifier.size())) {
+        return slot.symbol;
+      }
+    }
+  }
+
+  template <typename KeyOf>
+  size_t insert(SymbolId symbol, std::string_view /* identifier */,
+                NameTableHash hash, const KeyOf & /* key_of */) {
+    size_t replaced{0};
+    if ((m_size + 1) * MAX_LOAD_DENOMINATOR >
+        m_slots.size() * MAX_LOAD_NUMERATOR) {
+      replaced = grow();
+    }
+    place(Slot{hash, symbol});
+    m_size++;
+    return replaced;
+  }
+
+  void prefetch(NameTableHash hash) const {
+    NAMETABLE_PREFETCH(&m_slots[home(hash)]);
+  }
+
+  size_t bytes() const { return m_slots.capacity() * sizeof(Slot); }
+
+  void describe(NameTableStats &stats) const {
+    stats.slots = m_slots.size();
+    stats.loadFactor =
+        static_cast<double>(m_size) / static_cast<double>(m_slots.size());
+    for (size_t i = 0; i < m_slots.size(); i++) {
+      if (m_slots[i].symbol == -1) {
+        continue;
+      }
+      const size_t probe_length{distance(i)};
+      if (probe_length >= stats.probeLengths.size()) {
+        stats.probeLengths.resize(probe_length + 1, 0);
+      }
+      stats.probeLengths[probe_length]++;
+    }
+  }
+
+  static const char *name() { return "open addressing"; }
+
+private:
+  struct Slot {
+    NameTableHash hash;
+    SymbolId symbol; // -1 if the slot is empty
+  };
+
+  // Capacity must stay a power of two so that `home()` can mask instead of mod
+  static const size_t INITIAL_CAPACITY = 64;
+
+  // Grow once the table is more than 7/8 full. Robin Hood ordering keeps probe
+  // lengths short even at high load.
+  static const size_t MAX_LOAD_NUMERATOR = 7;
+  static const size_t MAX_LOAD_DENOMINATOR = 8;
+
+  size_t home(NameTableHash hash) const { return hash & (m_slots.size() - 1); }
+
+  size_t next(size_t index) const { return (index + 1) & (m_slots.size() - 1); }
+
+  // How far the entry in an occupied slot is from its home slot
+  size_t distance(size_t index) const {
+    return (index - home(m_slots[index].hash)) & (m_slots.size() - 1);
+  }
+
+  void place(Slot incoming) {
+    size_t probe_distance{0};
+    for (size_t i = home(incoming.hash);; i = next(i), probe_distance++) {
+      Slot &slot = m_slots[i];
+      if (slot.symbol == -1) {
+        slot = incoming;
+        return;
+      }
+
+      // Robin Hood: take the slot from an entry that is closer to home, then
+      // keep probing on behalf of the displaced entry
+      const size_t resident_distance{distance(i)};
+      if (resident_distance < probe_distance) {
+        std::swap(slot, incoming);
+        probe_distance = resident_distance;
+      }
+    }
+  }
+
+  // Returns the size of the old slots, which are alive until this returns
+  size_t grow() {
+    std::vector<Slot> old_slots{m_slots.size() * 2, Slot{0, -1}};
+    old_slots.swap(m_slots);
+
+    for (const Slot &slot : old_slots) {
+      if (slot.symbol != -1) {
+        place(slot);
+      }
+    }
+    return old_slots.capacity() * sizeof(Slot);
+  }
+
+  size_t m_size;
+  std::vector<Slot> m_slots;
+};
+
+//========================================================================
+// ChainedHashIndex
+//========================================================================
+
+// A hash table of singly linked chains, as NameTable originally used. The
+// links live in one array indexed by symbol rather than in separately
+// allocated nodes.
+class ChainedHashIndex {
+public:
+  ChainedHashIndex() : m_buckets(INITIAL_BUCKETS, -1) {}
+
+  template <typename KeyOf>
+  SymbolId find(std::string_view identifier, NameTableHash hash,
+                const KeyOf &key_of) const {
+    for (SymbolId symbol = m_buckets[bucket(hash)]; symbol != -1;
+         symbol = m_entries[symbol].next) {
+      if (m_entries[symbol].hash == hash && key_of(symbol) == identifier) {
+        return symbol;
+      }
+    }
+    return -1;
+  }
+
+  template <typename KeyOf>
+  size_t insert(SymbolId symbol, std::string_view /* identifier */,
+                NameTableHash hash, const KeyOf & /* key_of */) {
+    size_t replaced{0};
+    if (m_entries.size() + 1 > m_buckets.size()) {
+      replaced = grow();
+    }
+    SymbolId &head = m_buckets[bucket(hash)];
+    m_entries.push_back(Entry{hash, head});
+    head = symbol;
+    return replaced;
+  }
+
+  void prefetch(NameTableHash hash) const {
+    NAMETABLE_PREFETCH(&m_buckets[bucket(hash)]);
+  }
+
+  size_t bytes() const {
+    return m_buckets.capacity() * sizeof(SymbolId) +
+           m_entries.capacity() * sizeof(Entry);
+  }
+
+  void describe(NameTableStats &stats) const {
+    stats.slots = m_buckets.size();
+    stats.loadFactor = static_cast<double>(m_entries.size()) /
+                       static_cast<double>(m_buckets.size());
+    for (SymbolId head : m_buckets) {
+      size_t position{0};
+      for (SymbolId symbol = head; symbol != -1;
+           symbol = m_entries[symbol].next, position++) {
+        if (position >= stats.probeLengths.size()) {
+          stats.probeLengths.resize(position + 1, 0);
+        }
+        stats.probeLengths[position]++;
+      }
+    }
+  }
+
+  static const char *name() { return "chained hash"; }
+
+private:
+  struct Entry {
+    NameTableHash hash;
+    SymbolId next; // The next symbol in the same chain, or -1
+  };
+
+  // Must stay a power of two so that `bucket()` can mask instead of mod
+  static const size_t INITIAL_BUCKETS = 64;
+
+  size_t bucket(NameTableHash hash) const {
+    return hash & (m_buckets.size() - 1);
+  }
+
+  // Double the buckets, keeping the load factor at most 1. Returns the size of
+  // the old buckets, which are alive until this returns.
+  size_t grow() {
+    std::vector<SymbolId> old_buckets(m_buckets.size() * 2, -1);
+    old_buckets.swap(m_buckets);
+    for (SymbolId symbol = 0; symbol < static_cast<SymbolId>(m_entries.size());
+         symbol++) {
+      SymbolId &head = m_buckets[bucket(m_entries[symbol].hash)];
+      m_entries[symbol].next = head;
+      head = symbol;
+    }
+    return old_buckets.capacity() * sizeof(SymbolId);
+  }
+
+  std::vector<SymbolId> m_buckets; // First symbol in each chain, or -1
+  std::vector<Entry> m_entries;    // Indexed by symbol
+};
+
+//========================================================================
+// TernarySearchTrieIndex
+//========================================================================
+
+// A ternary search trie: each node splits on one character, with subtries for
+// smaller and larger characters and one for identifiers that continue past a
+// match. No hashing and no whole-key comparisons, at the cost of one node
+// visit per character.
+class TernarySearchTrieIndex {
+public:
+  TernarySearchTrieIndex() : m_root{-1} {}
+
+  template <typename KeyOf>
+  SymbolId find(std::string_view identifier, NameTableHash /* hash */,
+                const KeyOf & /* key_of */) const {
+    size_t position{0};
+    int node = m_root;
+    while (node != -1) {
+      const Node &current = m_nodes[node];
+      const char c = identifier[position];
+      if (c < current.split) {
+        node = current.low;
+      } else if (c > current.split) {
+        node = current.high;
+      } else if (position + 1 == identifier.size()) {
+        return current.symbol;
+      } else {
+        position++;
+        node = current.equal;
+      }
+    }
+    return -1;
+  }
+
+  template <typename KeyOf>
+  size_t insert(SymbolId symbol, std::string_view identifier,
+                NameTableHash /* hash */, const KeyOf & /* key_of */) {
+    if (m_root == -1) {
+      m_nodes.push_back(Node{identifier[0], -1, -1, -1, -1});
+      m_root = 0;
+    }
+
+    size_t position{0};
+    int node = m_root;
+    for (;;) {
+      const char c = identifier[position];
+      if (c < m_nodes[node].split) {
+        node = child(node, &Node::low, c);
+      } else if (c > m_nodes[node].split) {
+        node = child(node, &Node::high, c);
+      } else if (position + 1 == identifier.size()) {
+        m_nodes[node].symbol = symbol;
+        return 0;
+      } else {
+        position++;
+        node = child(node, &Node::equal, identifier[position]);
+      }
+    }
+  }
+
+  // Every search starts at the root, which stays cached anyway
+  void prefetch(NameTableHash /* hash */) const {}
+
+  size_t bytes() const { return m_nodes.capacity() * sizeof(Node); }
+
+  // A trie has no slots or probes
+  void describe(NameTableStats & /* stats */) const {}
+
+  static const char *name() { return "ternary search trie"; }
+
+private:
+  struct Node {
+    char split;
+    SymbolId symbol; // The identifier that ends here, or -1
+    int low;         // Subtrie for characters less than `split`, or -1
+    int equal;       // Subtrie for the rest of identifiers matching `split`
+    int high;        // Subtrie for characters greater than `split`
+  };
+
+  // Follow one of a node's links, first creating a node that splits on
+  // `split` if the link is empty. Links are indexes rather than pointers,
+  // since adding a node may move them all.
+  int child(int node, int Node::*link, char split) {
+    if (m_nodes[node].*link == -1) {
+      m_nodes.push_back(Node{split, -1, -1, -1, -1});
+      m_nodes[node].*link = static_cast<int>(m_nodes.size()) - 1;
+    }
+    return m_nodes[node].*link;
+  }
+
+  int m_root;
+  std::vector<Node> m_nodes;
+};
+
+//========================================================================
+// SortedVectorIndex
+//========================================================================
+
+// Symbols sorted by identifier in one vector, searched by bisection. Lookups
+// touch O(log n) identifiers; inserting shifts everything after the new one.
+class SortedVectorIndex {
+public:
+  template <typename KeyOf>
+  SymbolId find(std::string_view identifier, NameTableHash /* hash */,
+                const KeyOf &key_of) const {
+    auto it = lower_bound(identifier, key_of);
+    if (it != m_sorted.end() && key_of(*it) == identifier) {
+      return *it;
+    }
+    return -1;
+  }
+
+  template <typename KeyOf>
+  size_t insert(SymbolId symbol, std::string_view identifier,
+                NameTableHash /* hash */, const KeyOf &key_of) {
+    m_sorted.insert(lower_bound(identifier, key_of), symbol);
+    return 0;
+  }
+
+  // Where a bisection goes depends on the identifier, not its hash
+  void prefetch(NameTableHash /* hash */) const {}
+
+  size_t bytes() const { return m_sorted.capacity() * sizeof(SymbolId); }
+
+  // A sorted vector has no slots or probes
+  void describe(NameTableStats & /* stats */) const {}
+
+  static const char *name() { return "sorted vector"; }
+
+private:
+  template <typename KeyOf>
+  std::vector<SymbolId>::const_iterator
+  lower_bound(std::string_view identifier, const KeyOf &key_of) const {
+    return std::lower_bound(m_sorted.begin(), m_sorted.end(), identifier,
+                            [&key_of](SymbolId symbol, std::string_view id) {
+                              return key_of(symbol) < id;
+                            });
+  }
+
+  std::vector<SymbolId> m_sorted;
+};
+
+#endif // NAMETABLEINDEX_INCLUDED
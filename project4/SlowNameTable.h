@@ -0,0 +1,90 @@
+// SlowNameTable.h
+
+// The correct but inefficient NameTable from NameTable.slow.cpp, as a class
+// of its own so that test and benchmark programs can link it alongside the
+// real NameTable and compare the two.
+
+#ifndef SLOWNAMETABLE_INCLUDED
+#define SLOWNAMETABLE_INCLUDED
+
+#include <string>
+#include <vector>
+
+class SlowNameTable {
+public:
+  void enterScope();
+  bool exitScope();
+  bool declare(const std::string &id, int lineNum);
+  int find(const std::string &id) const;
+
+private:
+  std::vector<std::string> m_ids;
+  std::vector<int> m_lines;
+};
+
+inline void SlowNameTable::enterScope() {
+  // Extend the id vector with an empty string that
+  // serves as a scope entry marker.
+
+  m_ids.push_back("");
+  m_lines.push_back(0);
+}
+
+inline bool SlowNameTable::exitScope() {
+  // Remove ids back to the last scope entry.
+
+  while (!m_ids.empty() && m_ids.back() != "") {
+    m_ids.pop_back();
+    m_lines.pop_back();
+  }
+  if (m_ids.empty())
+    return false;
+
+  // Remove the scope entry marker itself.
+
+  m_ids.pop_back();
+  m_lines.pop_back();
+  return true;
+}
+
+inline bool SlowNameTable::declare(const std::string &id, int lineNum) {
+  if (id.empty())
+    return false;
+
+  // Check for another declaration in the same scope.
+  // Return if found, break out if encounter the scope
+  // entry marker.
+
+  size_t k = m_ids.size();
+  while (k > 0) {
+    k--;
+    if (m_ids[k].empty())
+      break;
+    if (m_ids[k] == id)
+      return false;
+  }
+
+  // Save the declaration
+
+  m_ids.push_back(id);
+  m_lines.push_back(lineNum);
+  return true;
+}
+
+inline int SlowNameTable::find(const std::string &id) const {
+  if (id.empty())
+    return -1;
+
+  // Search back for the most recent declaration still
+  // available.
+
+  size_t k = m_ids.size();
+  while (k > 0) {
+    k--;
+    if (m_ids[k] == id)
+      return m_lines[k];
+  }
+  return -1;
+}
+
+#endif // SLOWNAMETABLE_INCLUDED
@@ -0,0 +1,179 @@
+// Workload.h
+
+// Generation, parsing and printing of NameTable command streams.  The
+// generator is the one from generateTests.cpp, with its tuning constants
+// turned into options and its random engine seeded explicitly, so that the
+// same seed always produces the same stream.
+
+#ifndef WORKLOAD_INCLUDED
+#define WORKLOAD_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct WorkloadOptions {
+  double probScopeChange = 0.10;
+  double enterBias = 0.54;
+  double probDeclareVsUse = 0.20;
+  double probUndeclared = 0.01;
+  double probDupDeclare = 0.01;
+  double probDefaultIdLen = 0.80;
+  int defaultIdLen = 6;
+  int maxIdLen = 20;
+};
+
+// One line of a commands.txt file
+struct WorkloadCommand {
+  enum Kind { ENTER_SCOPE, EXIT_SCOPE, DECLARE, FIND };
+
+  Kind kind;
+  std::string id; // Empty for ENTER_SCOPE and EXIT_SCOPE
+  int lineNum;    // Only meaningful for DECLARE
+};
+
+class WorkloadGenerator {
+public:
+  WorkloadGenerator(unsigned long long seed, const WorkloadOptions &options)
+      : m_engine(seed), m_options(options) {}
+
+  // Generate about nlines commands, followed by enough EXIT_SCOPE commands
+  // to close every scope that is still open.
+  std::vector<WorkloadCommand> generate(int nlines);
+
+  bool trueWithProb(double p) {
+    std::uniform_real_distribution<> distro(0, 1);
+    return distro(m_engine) < p;
+  }
+
+  int randInt(int n) {
+    std::uniform_int_distribution<> distro(0, n - 1);
+    return distro(m_engine);
+  }
+
+  std::string generateName() {
+    int len = m_options.defaultIdLen;
+    if (!trueWithProb(m_options.probDefaultIdLen))
+      len = 1 + randInt(m_options.maxIdLen);
+    std::string name(len, ' ');
+    for (int k = 0; k < len; k++) {
+      int r = randInt(2 * 26);
+      name[k] = static_cast<char>(r < 26 ? 'a' + r : 'A' + r - 26);
+    }
+    return name;
+  }
+
+private:
+  std::mt19937_64 m_engine;
+  WorkloadOptions m_options;
+};
+
+// Parse one line of a commands.txt file the way testNameTable.cpp does.
+// Returns false for a line with no command on it.
+inline bool parseCommand(const std::string &line, WorkloadCommand &cmd) {
+  std::istringstream iss(line);
+  std::string field1;
+  if (!(iss >> field1))
+    return false;
+  if (field1 == "{") {
+    cmd = WorkloadCommand{WorkloadCommand::ENTER_SCOPE, "", 0};
+    return true;
+  }
+  if (field1 == "}") {
+    cmd = WorkloadCommand{WorkloadCommand::EXIT_SCOPE, "", 0};
+    return true;
+  }
+  int field2;
+  if (!(iss >> field2))
+    cmd = WorkloadCommand{WorkloadCommand::FIND, field1, 0};
+  else
+    cmd = WorkloadCommand{WorkloadCommand::DECLARE, field1, field2};
+  return true;
+}
+
+inline std::vector<WorkloadCommand> readWorkload(std::istream &dataf) {
+  std::vector<WorkloadCommand> commands;
+  std::string line;
+  WorkloadCommand cmd;
+  while (std::getline(dataf, line)) {
+    if (parseCommand(line, cmd))
+      commands.push_back(cmd);
+  }
+  return commands;
+}
+
+inline void writeCommand(std::ostream &outf, const WorkloadCommand &cmd) {
+  switch (cmd.kind) {
+  case WorkloadCommand::ENTER_SCOPE:
+    outf << "{\n";
+    break;
+  case WorkloadCommand::EXIT_SCOPE:
+    outf << "}\n";
+    break;
+  case WorkloadCommand::DECLARE:
+    outf << cmd.id << ' ' << cmd.lineNum << '\n';
+    break;
+  case WorkloadCommand::FIND:
+    outf << cmd.id << '\n';
+    break;
+  }
+}
+
+inline std::vector<WorkloadCommand> WorkloadGenerator::generate(int nlines) {
+  std::vector<WorkloadCommand> commands;
+
+  int n = 1;
+  for (auto s : {"sanityA 1",  "sanityB 2",  "sanityA",    "sanityB",
+                 "sanityC",    "{",          "sanityB 7",  "sanityC 8",
+                 "sanityA",    "sanityB",    "sanityC",    "{",
+                 "sanityA 13", "sanityB 14", "sanityB 15", "sanityA",
+                 "}",          "sanityA",    "sanityB",    "{",
+                 "sanityB 21", "sanityB",    "}",          "}",
+                 "sanityA",    "sanityB",    "sanityC",    "{",
+                 "sanityB 29", "sanityB",    "}"}) {
+    WorkloadCommand cmd;
+    parseCommand(s, cmd);
+    commands.push_back(cmd);
+    n++;
+  }
+
+  int nestingLevel = 0;
+  std::vector<std::string> ids;
+  for (; n <= nlines; n++) {
+    if (trueWithProb(m_options.probScopeChange)) {
+      if (nestingLevel > 0 &&
+          trueWithProb(n < nlines / 2 ? (1 - m_options.enterBias)
+                                      : m_options.enterBias)) {
+        commands.push_back(WorkloadCommand{WorkloadCommand::EXIT_SCOPE, "", 0});
+        nestingLevel--;
+      } else {
+        commands.push_back(
+            WorkloadCommand{WorkloadCommand::ENTER_SCOPE, "", 0});
+        nestingLevel++;
+      }
+    } else if (trueWithProb(m_options.probDeclareVsUse) || ids.empty()) {
+      std::string name = generateName();
+      ids.push_back(name);
+      if (!trueWithProb(m_options.probUndeclared))
+        commands.push_back(WorkloadCommand{WorkloadCommand::DECLARE, name, n});
+      else
+        commands.push_back(WorkloadCommand{WorkloadCommand::FIND, name, 0});
+    } else if (trueWithProb(m_options.probDupDeclare))
+      commands.push_back(WorkloadCommand{
+          WorkloadCommand::DECLARE, ids[randInt(static_cast<int>(ids.size()))],
+          n});
+    else
+      commands.push_back(WorkloadCommand{
+          WorkloadCommand::FIND, ids[randInt(static_cast<int>(ids.size()))],
+          0});
+  }
+  for (; nestingLevel > 0; nestingLevel--)
+    commands.push_back(WorkloadCommand{WorkloadCommand::EXIT_SCOPE, "", 0});
+
+  return commands;
+}
+
+#endif // WORKLOAD_INCLUDED
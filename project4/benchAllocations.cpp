@@ -0,0 +1,78 @@
+// NameTable allocation benchmark
+//
+// Counts heap allocations made by NameTable::declare once the table has warmed
+// up. Every identifier in the workload has already been declared once, and the
+// table has already reached its deepest nesting, so a declaration should be
+// able to reuse storage the table already owns.
+
+#include "NameTable.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+using namespace std;
+
+const int NUM_IDS = 5000;
+const int NUM_SCOPES = 50;
+const int ROUNDS = 20;
+
+long long allocationCount = 0;
+
+void *operator new(size_t size) {
+  allocationCount++;
+  void *p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr)
+    throw bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t /* size */) noexcept { free(p); }
+
+// Long enough that none of these fit in std::string's small buffer
+string makeId(int k) { return "identifier_number_" + to_string(k); }
+
+// Declares every id, spread across NUM_SCOPES nested scopes, then closes them.
+// Returns the number of successful declarations.
+long long runRound(NameTable &nt, const vector<string> &ids, int round) {
+  long long declared = 0;
+  for (int s = 0; s < NUM_SCOPES; s++) {
+    nt.enterScope();
+    for (size_t k = s; k < ids.size(); k += NUM_SCOPES)
+      declared += nt.declare(ids[k], round * NUM_IDS + static_cast<int>(k));
+  }
+  for (int s = 0; s < NUM_SCOPES; s++)
+    nt.exitScope();
+  return declared;
+}
+
+int main() {
+  vector<string> ids;
+  for (int k = 0; k < NUM_IDS; k++)
+    ids.push_back(makeId(k));
+
+  NameTable nt;
+
+  long long before = allocationCount;
+  long long warmupDeclares = runRound(nt, ids, 0);
+  long long warmupAllocations = allocationCount - before;
+
+  before = allocationCount;
+  long long steadyDeclares = 0;
+  for (int r = 1; r <= ROUNDS; r++)
+    steadyDeclares += runRound(nt, ids, r);
+  long long steadyAllocations = allocationCount - before;
+
+  cout << "Warm-up: " << warmupAllocations << " allocations for "
+       << warmupDeclares << " declarations ("
+       << static_cast<double>(warmupAllocations) / warmupDeclares
+       << " per declare)" << endl;
+  cout << "Steady state: " << steadyAllocations << " allocations for "
+       << steadyDeclares << " declarations ("
+       << static_cast<double>(steadyAllocations) / steadyDeclares
+       << " per declare)" << endl;
+
+  return steadyAllocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+// NameTable batch API benchmark
+//
+// Usage:  benchBatch [--option=value ...]
+//
+//   --seed=N      random seed for the generated workload (1)
+//   --lines=N     about how many commands to generate (1000000)
+//   --batch=N     most identifiers passed to one batch call (64)
+//   --repeat=N    time each variant N times and keep the fastest (5)
+//
+// Times two things, each once with single calls and once with declareBatch
+// and findBatch:
+//
+//   replay   the whole workload, with each stretch of consecutive
+//            declarations or lookups (up to --batch of them) made as one
+//            batch, as a front end resolving a statement at a time would
+//   lookups  every lookup in the workload against the table as the workload
+//            leaves it, in batches of --batch
+//
+// The exit status is nonzero if batched and single calls ever disagree.
+
+#include "NameTable.h"
+#include "Workload.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+using namespace std;
+
+bool parseOption(const string &arg, const string &name, string &value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+void mix(unsigned long long &checksum, long long value) {
+  checksum = (checksum ^ static_cast<unsigned long long>(value)) *
+             1099511628211ULL;
+}
+
+double elapsedMs(chrono::steady_clock::time_point begin) {
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - begin)
+      .count();
+}
+
+// The workload cut into the calls a batching caller would make: each step
+// is a scope change, or a run of declarations or lookups
+struct Step {
+  WorkloadCommand::Kind kind;
+  size_t first; // Index into declarations or ids
+  size_t count;
+};
+
+struct BatchedWorkload {
+  vector<Step> steps;
+  vector<pair<string_view, int>> declarations;
+  vector<string_view> ids;
+};
+
+BatchedWorkload batchWorkload(const vector<WorkloadCommand> &commands,
+                              size_t batch) {
+  BatchedWorkload result;
+  for (const WorkloadCommand &cmd : commands) {
+    bool extends = !result.steps.empty() &&
+                   result.steps.back().kind == cmd.kind &&
+                   result.steps.back().count < batch;
+    switch (cmd.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+    case WorkloadCommand::EXIT_SCOPE:
+      result.steps.push_back(Step{cmd.kind, 0, 0});
+      break;
+    case WorkloadCommand::DECLARE:
+      if (!extends)
+        result.steps.push_back(
+            Step{cmd.kind, result.declarations.size(), 0});
+      result.declarations.emplace_back(cmd.id, cmd.lineNum);
+      result.steps.back().count++;
+      break;
+    case WorkloadCommand::FIND:
+      if (!extends)
+        result.steps.push_back(Step{cmd.kind, result.ids.size(), 0});
+      result.ids.push_back(cmd.id);
+      result.steps.back().count++;
+      break;
+    }
+  }
+  return result;
+}
+
+unsigned long long replaySingle(const BatchedWorkload &work) {
+  unsigned long long checksum = 14695981039346656037ULL;
+  NameTable table;
+  for (const Step &step : work.steps) {
+    switch (step.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+      table.enterScope();
+      break;
+    case WorkloadCommand::EXIT_SCOPE:
+      mix(checksum, table.exitScope());
+      break;
+    case WorkloadCommand::DECLARE:
+      for (size_t k = step.first; k < step.first + step.count; k++)
+        mix(checksum, table.declare(work.declarations[k].first,
+                                    work.declarations[k].second));
+      break;
+    case WorkloadCommand::FIND:
+      for (size_t k = step.first; k < step.first + step.count; k++)
+        mix(checksum, table.find(work.ids[k]));
+      break;
+    }
+  }
+  return checksum;
+}
+
+unsigned long long replayBatched(const BatchedWorkload &work, size_t batch) {
+  unsigned long long checksum = 14695981039346656037ULL;
+  NameTable table;
+  unique_ptr<bool[]> declared(new bool[batch]);
+  vector<int> lines(batch);
+  for (const Step &step : work.steps) {
+    switch (step.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+      table.enterScope();
+      break;
+    case WorkloadCommand::EXIT_SCOPE:
+      mix(checksum, table.exitScope());
+      break;
+    case WorkloadCommand::DECLARE:
+      table.declareBatch(&work.declarations[step.first], step.count,
+                         declared.get());
+      for (size_t k = 0; k < step.count; k++)
+        mix(checksum, declared[k]);
+      break;
+    case WorkloadCommand::FIND:
+      table.findBatch(&work.ids[step.first], step.count, lines.data());
+      for (size_t k = 0; k < step.count; k++)
+        mix(checksum, lines[k]);
+      break;
+    }
+  }
+  return checksum;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long long seed = 1;
+  int nlines = 1000000;
+  size_t batch = 64;
+  int repeat = 5;
+
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    string value;
+    if (parseOption(arg, "seed", value))
+      seed = strtoull(value.c_str(), nullptr, 10);
+    else if (parseOption(arg, "lines", value))
+      nlines = atoi(value.c_str());
+    else if (parseOption(arg, "batch", value))
+      batch = strtoul(value.c_str(), nullptr, 10);
+    else if (parseOption(arg, "repeat", value))
+      repeat = atoi(value.c_str());
+    else {
+      cerr << "Unknown option " << arg << endl;
+      return 2;
+    }
+  }
+  if (batch < 1)
+    batch = 1;
+  if (repeat < 1)
+    repeat = 1;
+
+  WorkloadGenerator generator(seed, WorkloadOptions());
+  vector<WorkloadCommand> commands = generator.generate(nlines);
+  BatchedWorkload work = batchWorkload(commands, batch);
+  bool agree = true;
+
+  double singleMs = -1;
+  double batchedMs = -1;
+  for (int run = 0; run < repeat; run++) {
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    unsigned long long singleSum = replaySingle(work);
+    double ms = elapsedMs(begin);
+    if (singleMs < 0 || ms < singleMs)
+      singleMs = ms;
+
+    begin = chrono::steady_clock::now();
+    unsigned long long batchedSum = replayBatched(work, batch);
+    ms = elapsedMs(begin);
+    if (batchedMs < 0 || ms < batchedMs)
+      batchedMs = ms;
+    if (singleSum != batchedSum)
+      agree = false;
+  }
+
+  // Leave the table as the workload does, then look everything up in it
+  NameTable table;
+  for (const WorkloadCommand &cmd : commands) {
+    if (cmd.kind == WorkloadCommand::ENTER_SCOPE)
+      table.enterScope();
+    else if (cmd.kind == WorkloadCommand::EXIT_SCOPE)
+      table.exitScope();
+    else if (cmd.kind == WorkloadCommand::DECLARE)
+      table.declare(cmd.id, cmd.lineNum);
+  }
+  vector<int> expected(work.ids.size());
+  vector<int> lines(work.ids.size());
+  double singleLookupMs = -1;
+  double batchedLookupMs = -1;
+  for (int run = 0; run < repeat; run++) {
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    for (size_t k = 0; k < work.ids.size(); k++)
+      expected[k] = table.find(work.ids[k]);
+    double ms = elapsedMs(begin);
+    if (singleLookupMs < 0 || ms < singleLookupMs)
+      singleLookupMs = ms;
+
+    begin = chrono::steady_clock::now();
+    for (size_t k = 0; k < work.ids.size(); k += batch)
+      table.findBatch(&work.ids[k], min(batch, work.ids.size() - k),
+                      &lines[k]);
+    ms = elapsedMs(begin);
+    if (batchedLookupMs < 0 || ms < batchedLookupMs)
+      batchedLookupMs = ms;
+    if (lines != expected)
+      agree = false;
+  }
+
+  size_t batchedSteps = 0;
+  for (const Step &step : work.steps)
+    batchedSteps += step.count > 0;
+  cout << commands.size() << " commands, " << work.ids.size() << " lookups, "
+       << table.stats().symbols << " symbols; batches of up to " << batch
+       << " (replay averages "
+       << fixed << setprecision(1)
+       << static_cast<double>(work.declarations.size() + work.ids.size()) /
+              max<size_t>(batchedSteps, 1)
+       << ")" << endl;
+  cout << left << setw(10) << "Test" << right << setw(12) << "Single ms"
+       << setw(12) << "Batched ms" << setw(10) << "Speedup" << endl;
+  cout << setprecision(2);
+  cout << left << setw(10) << "replay" << right << setw(12) << singleMs
+       << setw(12) << batchedMs << setw(9) << singleMs / batchedMs << "x"
+       << endl;
+  cout << left << setw(10) << "lookups" << right << setw(12)
+       << singleLookupMs << setw(12) << batchedLookupMs << setw(9)
+       << singleLookupMs / batchedLookupMs << "x" << endl;
+
+  if (!agree) {
+    cerr << "*** FAILED *** batched and single calls disagree" << endl;
+    return 1;
+  }
+}
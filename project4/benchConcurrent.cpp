@@ -0,0 +1,175 @@
+// ConcurrentNameTable read-scaling benchmark
+//
+// Usage:  benchConcurrent [--option=value ...]
+//
+//   --seed=N          random seed for the generated workload (1)
+//   --lines=N         about how many commands to generate (100000)
+//   --millis=N        how long to run each configuration (500)
+//   --max-threads=N   largest number of reader threads (hardware threads)
+//   --writer          keep a writer thread entering scopes, declaring and
+//                     exiting while the readers run
+//
+// Builds a ConcurrentNameTable from a generated workload, then has 1, 2, 4,
+// ... reader threads look up its identifiers as fast as they can.  Prints one
+// line per thread count with the total and per-thread lookup rate.  The
+// writer only touches identifiers the workload never uses, so every lookup
+// must return what it did before the readers started; the exit status is
+// nonzero if one does not.
+
+#include "ConcurrentNameTable.h"
+#include "Workload.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+bool parseOption(const string &arg, const string &name, string &value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+// Repeatedly declares a batch of fresh identifiers in a new scope and exits
+// it, so that readers see lines appear and disappear and the index grows
+void churn(ConcurrentNameTable &table, const atomic<bool> &stop,
+           long long &operations) {
+  long long round = 0;
+  while (!stop.load(memory_order_relaxed)) {
+    table.enterScope();
+    for (int k = 0; k < 64; k++)
+      table.declare("churn" + to_string(round % 4096) + "_" + to_string(k),
+                    static_cast<int>(round));
+    table.exitScope();
+    operations += 66;
+    round++;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long long seed = 1;
+  int nlines = 100000;
+  int millis = 500;
+  int maxThreads = static_cast<int>(thread::hardware_concurrency());
+  bool withWriter = false;
+
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    string value;
+    if (parseOption(arg, "seed", value))
+      seed = strtoull(value.c_str(), nullptr, 10);
+    else if (parseOption(arg, "lines", value))
+      nlines = atoi(value.c_str());
+    else if (parseOption(arg, "millis", value))
+      millis = atoi(value.c_str());
+    else if (parseOption(arg, "max-threads", value))
+      maxThreads = atoi(value.c_str());
+    else if (arg == "--writer")
+      withWriter = true;
+    else {
+      cerr << "Unknown option " << arg << endl;
+      return 2;
+    }
+  }
+  if (maxThreads < 1)
+    maxThreads = 1;
+  if (maxThreads > ConcurrentNameTable::MAX_READERS)
+    maxThreads = ConcurrentNameTable::MAX_READERS;
+
+  // Replay the declarations and scopes of the workload, and keep every
+  // identifier it looks up as the readers' query set
+  WorkloadGenerator generator(seed, WorkloadOptions());
+  vector<WorkloadCommand> commands = generator.generate(nlines);
+  ConcurrentNameTable table;
+  vector<string> queries;
+  for (const WorkloadCommand &cmd : commands) {
+    switch (cmd.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+      table.enterScope();
+      break;
+    case WorkloadCommand::EXIT_SCOPE:
+      table.exitScope();
+      break;
+    case WorkloadCommand::DECLARE:
+      table.declare(cmd.id, cmd.lineNum);
+      break;
+    case WorkloadCommand::FIND:
+      queries.push_back(cmd.id);
+      break;
+    }
+  }
+  if (queries.empty()) {
+    cerr << "The workload has no lookups" << endl;
+    return 1;
+  }
+  vector<int> expected;
+  for (const string &id : queries)
+    expected.push_back(table.find(id));
+  atomic<long long> mismatches(0);
+
+  cout << "Readers  Total Mlookups/s  Per-thread Mlookups/s"
+       << (withWriter ? "  Writer Mops/s" : "") << endl;
+
+  for (int nthreads = 1; nthreads <= maxThreads;
+       nthreads = nthreads < maxThreads && nthreads * 2 > maxThreads
+                      ? maxThreads
+                      : nthreads * 2) {
+    atomic<bool> stop(false);
+    vector<long long> lookups(nthreads, 0);
+    vector<thread> readers;
+    for (int t = 0; t < nthreads; t++) {
+      readers.emplace_back([&, t] {
+        ConcurrentNameTable::Reader reader = table.reader();
+        size_t k = queries.size() * t / nthreads;
+        long long count = 0;
+        long long wrong = 0;
+        while (!stop.load(memory_order_relaxed)) {
+          for (int batch = 0; batch < 256; batch++) {
+            wrong += reader.find(queries[k]) != expected[k];
+            if (++k == queries.size())
+              k = 0;
+          }
+          count += 256;
+        }
+        lookups[t] = count;
+        mismatches += wrong;
+      });
+    }
+
+    long long writerOps = 0;
+    thread writer;
+    if (withWriter)
+      writer = thread(churn, ref(table), cref(stop), ref(writerOps));
+
+    this_thread::sleep_for(chrono::milliseconds(millis));
+    stop.store(true);
+    for (thread &reader : readers)
+      reader.join();
+    if (withWriter)
+      writer.join();
+
+    long long total = 0;
+    for (long long count : lookups)
+      total += count;
+    double seconds = millis / 1000.0;
+    double totalRate = total / seconds / 1e6;
+    cout << nthreads << "  " << totalRate << "  " << totalRate / nthreads;
+    if (withWriter)
+      cout << "  " << writerOps / seconds / 1e6;
+    cout << endl;
+
+    if (nthreads == maxThreads)
+      break;
+  }
+
+  if (mismatches > 0) {
+    cerr << "*** FAILED *** " << mismatches << " lookups returned the wrong line"
+         << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,173 @@
+// NameTable index comparison
+//
+// Usage:  benchIndexes [--option=value ...]
+//
+//   --seed=N      random seed for the generated workload (1)
+//   --lines=N     about how many commands to generate (200000)
+//   --file=PATH   replay a commands.txt file instead of generating
+//   --repeat=N    run each index N times and keep the fastest (5)
+//
+// Runs one workload through NameTableEngine instantiated with every index in
+// NameTableIndex.h, and through SlowNameTable (the algorithm of
+// NameTable.slow.cpp) for reference, and prints a table of the time per
+// command and the memory each one ends up with.  The exit status is nonzero
+// if any of them ever disagrees with the others.
+
+#include "NameTableEngine.h"
+#include "NameTableIndex.h"
+#include "SlowNameTable.h"
+#include "Workload.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+struct IndexResult {
+  string name;
+  double bestMs;
+  unsigned long long checksum; // Combines every value the table returned
+  size_t bytes;
+  size_t peakBytes;
+};
+
+bool parseOption(const string &arg, const string &name, string &value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+void mix(unsigned long long &checksum, long long value) {
+  checksum = (checksum ^ static_cast<unsigned long long>(value)) *
+             1099511628211ULL;
+}
+
+// Engines are neither copyable nor movable, so each run builds its own
+template <typename Table>
+IndexResult runIndex(const string &name,
+                     const vector<WorkloadCommand> &commands, int repeat) {
+  using Clock = chrono::steady_clock;
+
+  IndexResult result;
+  result.name = name;
+  result.bestMs = -1;
+  result.bytes = 0;
+  result.peakBytes = 0;
+  for (int run = 0; run < repeat; run++) {
+    unsigned long long checksum = 14695981039346656037ULL;
+    Clock::time_point begin = Clock::now();
+    Table table;
+    for (const WorkloadCommand &cmd : commands) {
+      long long value = 0;
+      switch (cmd.kind) {
+      case WorkloadCommand::ENTER_SCOPE:
+        table.enterScope();
+        break;
+      case WorkloadCommand::EXIT_SCOPE:
+        value = table.exitScope();
+        break;
+      case WorkloadCommand::DECLARE:
+        if constexpr (is_same<Table, SlowNameTable>::value)
+          value = table.declare(cmd.id, cmd.lineNum);
+        else
+          value = !cmd.id.empty() &&
+                  table.declare(table.intern(cmd.id), cmd.lineNum);
+        break;
+      case WorkloadCommand::FIND:
+        value = table.find(cmd.id);
+        break;
+      }
+      mix(checksum, value);
+    }
+    double ms =
+        chrono::duration<double, milli>(Clock::now() - begin).count();
+    if (result.bestMs < 0 || ms < result.bestMs)
+      result.bestMs = ms;
+    result.checksum = checksum;
+    if constexpr (!is_same<Table, SlowNameTable>::value) {
+      NameTableStats stats = table.stats();
+      result.bytes = stats.bytesAllocated;
+      result.peakBytes = stats.peakBytesAllocated;
+    }
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long long seed = 1;
+  int nlines = 200000;
+  string file;
+  int repeat = 5;
+
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    string value;
+    if (parseOption(arg, "seed", value))
+      seed = strtoull(value.c_str(), nullptr, 10);
+    else if (parseOption(arg, "lines", value))
+      nlines = atoi(value.c_str());
+    else if (parseOption(arg, "file", value))
+      file = value;
+    else if (parseOption(arg, "repeat", value))
+      repeat = atoi(value.c_str());
+    else {
+      cerr << "Unknown option " << arg << endl;
+      return 2;
+    }
+  }
+  if (repeat < 1)
+    repeat = 1;
+
+  vector<WorkloadCommand> commands;
+  if (!file.empty()) {
+    ifstream dataf(file);
+    if (!dataf) {
+      cerr << "Cannot open " << file << endl;
+      return 1;
+    }
+    commands = readWorkload(dataf);
+  } else {
+    WorkloadGenerator generator(seed, WorkloadOptions());
+    commands = generator.generate(nlines);
+  }
+
+  vector<IndexResult> results;
+  results.push_back(runIndex<NameTableEngine<OpenAddressingIndex>>(
+      OpenAddressingIndex::name(), commands, repeat));
+  results.push_back(runIndex<NameTableEngine<ChainedHashIndex>>(
+      ChainedHashIndex::name(), commands, repeat));
+  results.push_back(runIndex<NameTableEngine<TernarySearchTrieIndex>>(
+      TernarySearchTrieIndex::name(), commands, repeat));
+  results.push_back(runIndex<NameTableEngine<SortedVectorIndex>>(
+      SortedVectorIndex::name(), commands, repeat));
+  results.push_back(runIndex<SlowNameTable>("SlowNameTable", commands, 1));
+
+  cout << commands.size() << " commands, best of " << repeat << " runs" << endl;
+  cout << left << setw(24) << "Index" << right << setw(12) << "Total ms"
+       << setw(12) << "ns/command" << setw(14) << "Bytes" << setw(14)
+       << "Peak bytes" << endl;
+  bool agree = true;
+  for (const IndexResult &result : results) {
+    cout << left << setw(24) << result.name << right << fixed << setprecision(2)
+         << setw(12) << result.bestMs << setprecision(1) << setw(12)
+         << result.bestMs * 1e6 / commands.size();
+    if (result.name == "SlowNameTable")
+      cout << setw(14) << "-" << setw(14) << "-";
+    else
+      cout << setw(14) << result.bytes << setw(14) << result.peakBytes;
+    cout << endl;
+    if (result.checksum != results[0].checksum)
+      agree = false;
+  }
+
+  if (!agree) {
+    cerr << "*** FAILED *** the indexes returned different results" << endl;
+    return 1;
+  }
+}
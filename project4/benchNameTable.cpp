@@ -0,0 +1,332 @@
+// NameTable benchmark
+//
+// Usage:  benchNameTable [--option=value ...]
+//
+//   --seed=N                  random seed for the generated workload (1)
+//   --lines=N                 about how many commands to generate (100000)
+//   --file=PATH               replay a commands.txt file instead of generating
+//   --prob-scopechange=P      PROB_SCOPECHANGE in generateTests.cpp (0.10)
+//   --enter-bias=P            ENTER_BIAS (0.54)
+//   --prob-declare-vs-use=P   PROB_DECLARE_VS_USE (0.20)
+//   --prob-undeclared=P       PROB_UNDECLARED (0.01)
+//   --prob-dupdeclare=P       PROB_DUPDECLARE (0.01)
+//   --prob-default-id-len=P   PROB_DEFAULT_ID_LEN (0.80)
+//   --default-id-len=N        DEFAULT_ID_LEN (6)
+//   --max-id-len=N            MAX_ID_LEN (20)
+//   --filter-counters=N       give NameTable a negative-lookup filter with
+//                             N counters (0, meaning no filter)
+//   --skip-slow               only run NameTable
+//
+// Runs the same workload against NameTable and SlowNameTable (the algorithm
+// of NameTable.slow.cpp), timing every call individually, and writes a JSON
+// report to standard output.  The exit status is nonzero if the two tables
+// ever disagree.
+
+#include "NameTable.h"
+#include "SlowNameTable.h"
+#include "Workload.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+const char *const OP_NAMES[] = {"enterScope", "exitScope", "declare", "find"};
+const int NUM_OPS = 4;
+
+struct BenchResult {
+  string name;
+  double totalMs;
+  unsigned long long checksum; // Combines every value the table returned
+  long startRssKb;
+  long peakRssKb;
+  vector<long long> samples[NUM_OPS]; // Nanoseconds per call, by command kind
+  bool hasFilterStats;
+  NameTableFilterStats filterStats;
+  bool hasStats;
+  NameTableStats stats;
+};
+
+// Linux lets a process reset its peak RSS by writing 5 to clear_refs.  Where
+// that is not available the peak covers the whole process lifetime.
+void resetPeakRss() {
+  ofstream clearRefs("/proc/self/clear_refs");
+  if (clearRefs)
+    clearRefs << "5" << flush;
+}
+
+long readStatusKb(const string &field) {
+  ifstream status("/proc/self/status");
+  string line;
+  while (getline(status, line)) {
+    if (line.compare(0, field.size(), field) == 0)
+      return atol(line.c_str() + field.size());
+  }
+  return -1;
+}
+
+long peakRssKb() {
+  long kb = readStatusKb("VmHWM:");
+  if (kb >= 0)
+    return kb;
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+void mix(unsigned long long &checksum, long long value) {
+  checksum = (checksum ^ static_cast<unsigned long long>(value)) *
+             1099511628211ULL;
+}
+
+template <typename Table>
+BenchResult runBenchmark(const string &name,
+                         const vector<WorkloadCommand> &commands,
+                         size_t filterCounters) {
+  using Clock = chrono::steady_clock;
+
+  BenchResult result;
+  result.name = name;
+  result.checksum = 14695981039346656037ULL;
+  result.hasFilterStats = false;
+  result.hasStats = false;
+  for (int op = 0; op < NUM_OPS; op++)
+    result.samples[op].reserve(commands.size());
+
+  resetPeakRss();
+  result.startRssKb = readStatusKb("VmRSS:");
+
+  Clock::time_point begin = Clock::now();
+  {
+    Table table;
+    if constexpr (is_same<Table, NameTable>::value) {
+      if (filterCounters > 0)
+        table.enableNegativeFilter(filterCounters);
+    }
+    for (const WorkloadCommand &cmd : commands) {
+      long long value = 0;
+      Clock::time_point start = Clock::now();
+      switch (cmd.kind) {
+      case WorkloadCommand::ENTER_SCOPE:
+        table.enterScope();
+        break;
+      case WorkloadCommand::EXIT_SCOPE:
+        value = table.exitScope();
+        break;
+      case WorkloadCommand::DECLARE:
+        value = table.declare(cmd.id, cmd.lineNum);
+        break;
+      case WorkloadCommand::FIND:
+        value = table.find(cmd.id);
+        break;
+      }
+      Clock::time_point stop = Clock::now();
+      result.samples[cmd.kind].push_back(
+          chrono::duration_cast<chrono::nanoseconds>(stop - start).count());
+      mix(result.checksum, value);
+    }
+    result.peakRssKb = peakRssKb();
+    if constexpr (is_same<Table, NameTable>::value) {
+      result.hasFilterStats = filterCounters > 0;
+      result.filterStats = table.filterStats();
+      result.hasStats = true;
+      result.stats = table.stats();
+    }
+  }
+  result.totalMs =
+      chrono::duration<double, milli>(Clock::now() - begin).count();
+
+  return result;
+}
+
+// The cost of reading the clock twice, which is included in every sample
+long long timerOverheadNs() {
+  using Clock = chrono::steady_clock;
+  const int TRIALS = 100000;
+  vector<long long> samples;
+  samples.reserve(TRIALS);
+  for (int k = 0; k < TRIALS; k++) {
+    Clock::time_point start = Clock::now();
+    Clock::time_point stop = Clock::now();
+    samples.push_back(
+        chrono::duration_cast<chrono::nanoseconds>(stop - start).count());
+  }
+  sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+long long percentile(const vector<long long> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  size_t k = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[k];
+}
+
+void writeResultJson(ostream &out, BenchResult &result) {
+  out << "    {\n"
+      << "      \"name\": \"" << result.name << "\",\n"
+      << "      \"total_ms\": " << result.totalMs << ",\n"
+      << "      \"checksum\": \"" << hex << result.checksum << dec << "\",\n"
+      << "      \"start_rss_kb\": " << result.startRssKb << ",\n"
+      << "      \"peak_rss_kb\": " << result.peakRssKb << ",\n";
+  if (result.hasFilterStats)
+    out << "      \"negative_filter\": {"
+        << "\"queries\": " << result.filterStats.queries << ", "
+        << "\"definite_misses\": " << result.filterStats.definiteMisses << ", "
+        << "\"false_positives\": " << result.filterStats.falsePositives
+        << "},\n";
+  if (result.hasStats) {
+    const NameTableStats &s = result.stats;
+    out << "      \"stats\": {"
+        << "\"live_declarations\": " << s.liveDeclarations << ", "
+        << "\"scope_depth\": " << s.scopeDepth << ", "
+        << "\"symbols\": " << s.symbols << ", "
+        << "\"slots\": " << s.slots << ", "
+        << "\"load_factor\": " << s.loadFactor << ", "
+        << "\"probe_lengths\": [";
+    for (size_t k = 0; k < s.probeLengths.size(); k++)
+      out << (k > 0 ? ", " : "") << s.probeLengths[k];
+    out << "], "
+        << "\"max_shadow_depth\": " << s.maxShadowDepth << ", "
+        << "\"bytes_allocated\": " << s.bytesAllocated << ", "
+        << "\"peak_bytes_allocated\": " << s.peakBytesAllocated;
+    if (s.countersEnabled)
+      out << ", "
+          << "\"declares\": " << s.declares << ", "
+          << "\"declare_failures\": " << s.declareFailures << ", "
+          << "\"finds\": " << s.finds << ", "
+          << "\"find_hits\": " << s.findHits << ", "
+          << "\"exit_scopes\": " << s.exitScopes << ", "
+          << "\"exit_scope_failures\": " << s.exitScopeFailures;
+    out << "},\n";
+  }
+  out << "      \"operations\": {\n";
+  for (int op = 0; op < NUM_OPS; op++) {
+    vector<long long> &samples = result.samples[op];
+    sort(samples.begin(), samples.end());
+    long double sum = 0;
+    for (long long ns : samples)
+      sum += ns;
+    double mean = samples.empty() ? 0 : static_cast<double>(sum / samples.size());
+    out << "        \"" << OP_NAMES[op] << "\": {"
+        << "\"count\": " << samples.size() << ", "
+        << "\"mean_ns\": " << mean << ", "
+        << "\"p50_ns\": " << percentile(samples, 0.50) << ", "
+        << "\"p90_ns\": " << percentile(samples, 0.90) << ", "
+        << "\"p99_ns\": " << percentile(samples, 0.99) << ", "
+        << "\"p999_ns\": " << percentile(samples, 0.999) << ", "
+        << "\"max_ns\": " << (samples.empty() ? 0 : samples.back()) << "}"
+        << (op + 1 < NUM_OPS ? ",\n" : "\n");
+  }
+  out << "      }\n"
+      << "    }";
+}
+
+bool parseOption(const string &arg, const string &name, string &value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long long seed = 1;
+  int nlines = 100000;
+  string file;
+  bool skipSlow = false;
+  size_t filterCounters = 0;
+  WorkloadOptions options;
+
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    string value;
+    if (parseOption(arg, "seed", value))
+      seed = strtoull(value.c_str(), nullptr, 10);
+    else if (parseOption(arg, "lines", value))
+      nlines = atoi(value.c_str());
+    else if (parseOption(arg, "file", value))
+      file = value;
+    else if (parseOption(arg, "prob-scopechange", value))
+      options.probScopeChange = atof(value.c_str());
+    else if (parseOption(arg, "enter-bias", value))
+      options.enterBias = atof(value.c_str());
+    else if (parseOption(arg, "prob-declare-vs-use", value))
+      options.probDeclareVsUse = atof(value.c_str());
+    else if (parseOption(arg, "prob-undeclared", value))
+      options.probUndeclared = atof(value.c_str());
+    else if (parseOption(arg, "prob-dupdeclare", value))
+      options.probDupDeclare = atof(value.c_str());
+    else if (parseOption(arg, "prob-default-id-len", value))
+      options.probDefaultIdLen = atof(value.c_str());
+    else if (parseOption(arg, "default-id-len", value))
+      options.defaultIdLen = atoi(value.c_str());
+    else if (parseOption(arg, "max-id-len", value))
+      options.maxIdLen = atoi(value.c_str());
+    else if (parseOption(arg, "filter-counters", value))
+      filterCounters = strtoull(value.c_str(), nullptr, 10);
+    else if (arg == "--skip-slow")
+      skipSlow = true;
+    else {
+      cerr << "Unknown option " << arg << endl;
+      return 2;
+    }
+  }
+
+  vector<WorkloadCommand> commands;
+  if (!file.empty()) {
+    ifstream dataf(file);
+    if (!dataf) {
+      cerr << "Cannot open " << file << endl;
+      return 2;
+    }
+    commands = readWorkload(dataf);
+  } else {
+    WorkloadGenerator generator(seed, options);
+    commands = generator.generate(nlines);
+  }
+
+  vector<BenchResult> results;
+  results.push_back(runBenchmark<NameTable>("NameTable", commands, filterCounters));
+  if (!skipSlow)
+    results.push_back(runBenchmark<SlowNameTable>("SlowNameTable", commands, 0));
+
+  bool match = true;
+  for (const BenchResult &result : results)
+    match = match && result.checksum == results[0].checksum;
+
+  ostream &out = cout;
+  out << "{\n";
+  if (file.empty())
+    out << "  \"seed\": " << seed << ",\n"
+        << "  \"lines\": " << nlines << ",\n";
+  else
+    out << "  \"file\": \"" << file << "\",\n";
+  out << "  \"options\": {"
+      << "\"prob_scopechange\": " << options.probScopeChange << ", "
+      << "\"enter_bias\": " << options.enterBias << ", "
+      << "\"prob_declare_vs_use\": " << options.probDeclareVsUse << ", "
+      << "\"prob_undeclared\": " << options.probUndeclared << ", "
+      << "\"prob_dupdeclare\": " << options.probDupDeclare << ", "
+      << "\"prob_default_id_len\": " << options.probDefaultIdLen << ", "
+      << "\"default_id_len\": " << options.defaultIdLen << ", "
+      << "\"max_id_len\": " << options.maxIdLen << "},\n"
+      << "  \"commands\": " << commands.size() << ",\n"
+      << "  \"timer_overhead_ns\": " << timerOverheadNs() << ",\n"
+      << "  \"results_match\": " << (match ? "true" : "false") << ",\n"
+      << "  \"implementations\": [\n";
+  for (size_t k = 0; k < results.size(); k++) {
+    writeResultJson(out, results[k]);
+    out << (k + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n"
+      << "}" << endl;
+
+  return match ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+// Usage:  convertCommands input.txt output.bin
+//
+// Convert a commands.txt workload to the binary command log format described
+// in CommandLog.h.
+
+#include "CommandLog.h"
+#include "Workload.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    cerr << "Usage: " << argv[0] << " input.txt output.bin" << endl;
+    return 2;
+  }
+
+  ifstream inf(argv[1]);
+  if (!inf) {
+    cerr << "Cannot open " << argv[1] << endl;
+    return 1;
+  }
+  vector<WorkloadCommand> commands = readWorkload(inf);
+
+  ofstream outf(argv[2], ios::binary);
+  if (!outf) {
+    cerr << "Cannot create " << argv[2] << endl;
+    return 1;
+  }
+  if (!writeCommandLog(outf, commands)) {
+    cerr << "Cannot write " << argv[2] << endl;
+    return 1;
+  }
+
+  cout << "Converted " << commands.size() << " commands" << endl;
+}
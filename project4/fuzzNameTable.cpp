@@ -0,0 +1,583 @@
+// NameTable differential fuzzer
+//
+// Usage:  fuzzNameTable [--option=value ...]
+//
+//   --seed=N         seed of the first stream; stream k uses seed+k (1)
+//   --iterations=N   how many streams to try, 0 for no limit (1000)
+//   --seconds=N      stop after this many seconds, whatever --iterations says
+//   --lines=N        about how long each stream is at most (4000)
+//   --out=PATH       where to write a minimized failing stream
+//                    (fuzz-failure.txt)
+//   --replay=PATH    check every table against one commands.txt file
+//                    instead of fuzzing
+//
+// Each stream is built from stretches of two kinds.  Some come from the
+// generator in generateTests.cpp with its knobs (PROB_SCOPECHANGE and the
+// rest) chosen at random for the stretch.  The others are adversarial:
+// identifiers whose hashes collide, scopes nested thousands deep, one
+// identifier shadowed at every level, long identifiers that share prefixes,
+// scopes opened and closed over and over, and exits from the global scope.
+//
+// Every table below is run on the stream alongside SlowNameTable, the
+// algorithm of NameTable.slow.cpp.  SlowNameTable discards global
+// declarations on a "}" with no scope open, so there the others are only
+// required to return false.  When a table disagrees, the stream is cut down
+// by delta debugging to a small one on which it still disagrees.  That
+// stream is written to --out in the commands.txt format, and the exit
+// status is 1.
+
+#include "ConcurrentNameTable.h"
+#include "NameTable.h"
+#include "NameTableEngine.h"
+#include "NameTableIndex.h"
+#include "SlowNameTable.h"
+#include "Workload.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+//========================================================================
+// The tables under test
+//========================================================================
+
+// A NameTable whose negative-lookup filter is small enough that its counters
+// are shared and saturate
+struct FilteredNameTable : public NameTable {
+  FilteredNameTable() { enableNegativeFilter(64); }
+};
+
+// A NameTable that leaves every scope by restoring a snapshot taken just
+// before entering it, which must come to the same thing
+class RestoringNameTable {
+public:
+  void enterScope() {
+    m_snapshots.push_back(m_table.snapshot());
+    m_table.enterScope();
+  }
+  bool exitScope() {
+    if (m_snapshots.empty())
+      return m_table.exitScope();
+    bool restored = m_table.restore(m_snapshots.back());
+    m_snapshots.pop_back();
+    return restored;
+  }
+  bool declare(const string &id, int lineNum) {
+    return m_table.declare(id, lineNum);
+  }
+  int find(const string &id) const { return m_table.find(id); }
+
+private:
+  NameTable m_table;
+  vector<NameTableSnapshot> m_snapshots;
+};
+
+bool declareIn(NameTable &table, const string &id, int lineNum) {
+  return table.declare(id, lineNum);
+}
+
+bool declareIn(RestoringNameTable &table, const string &id, int lineNum) {
+  return table.declare(id, lineNum);
+}
+
+bool declareIn(ConcurrentNameTable &table, const string &id, int lineNum) {
+  return table.declare(id, lineNum);
+}
+
+template <typename Index>
+bool declareIn(NameTableEngine<Index> &table, const string &id, int lineNum) {
+  return !id.empty() && table.declare(table.intern(id), lineNum);
+}
+
+// Returns the position of the first command on which a Table and
+// SlowNameTable disagree, or -1 if they never do
+template <typename Table>
+long long firstMismatch(const vector<WorkloadCommand> &commands) {
+  Table table;
+  SlowNameTable oracle;
+  int depth = 0;
+  for (size_t k = 0; k < commands.size(); k++) {
+    const WorkloadCommand &cmd = commands[k];
+    bool agree = true;
+    switch (cmd.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+      table.enterScope();
+      oracle.enterScope();
+      depth++;
+      break;
+    case WorkloadCommand::EXIT_SCOPE:
+      if (depth == 0)
+        agree = !table.exitScope();
+      else {
+        agree = table.exitScope() == oracle.exitScope();
+        depth--;
+      }
+      break;
+    case WorkloadCommand::DECLARE:
+      agree = declareIn(table, cmd.id, cmd.lineNum) ==
+              oracle.declare(cmd.id, cmd.lineNum);
+      break;
+    case WorkloadCommand::FIND:
+      agree = table.find(cmd.id) == oracle.find(cmd.id);
+      break;
+    }
+    if (!agree)
+      return static_cast<long long>(k);
+  }
+  return -1;
+}
+
+struct Target {
+  const char *name;
+  long long (*check)(const vector<WorkloadCommand> &commands);
+};
+
+const Target TARGETS[] = {
+    {"NameTable", firstMismatch<NameTable>},
+    {"NameTable with negative filter", firstMismatch<FilteredNameTable>},
+    {"NameTable restoring snapshots", firstMismatch<RestoringNameTable>},
+    {"chained hash engine", firstMismatch<NameTableEngine<ChainedHashIndex>>},
+    {"ternary search trie engine",
+     firstMismatch<NameTableEngine<TernarySearchTrieIndex>>},
+    {"sorted vector engine", firstMismatch<NameTableEngine<SortedVectorIndex>>},
+    {"ConcurrentNameTable", firstMismatch<ConcurrentNameTable>},
+};
+
+//========================================================================
+// Stream generation
+//========================================================================
+
+// Pairs of distinct identifiers with the same full hash, and a group whose
+// hashes agree in the low 12 bits, so they share a home slot in any hash
+// table of up to 4096 slots.  Found once by brute force.
+struct Collisions {
+  vector<pair<string, string>> fullPairs;
+  vector<string> sameHome;
+};
+
+string randomName(mt19937_64 &engine, int len) {
+  static const char CHARS[] =
+      "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+  uniform_int_distribution<> distro(0, sizeof(CHARS) - 2);
+  string name(len, ' ');
+  for (char &c : name)
+    c = CHARS[distro(engine)];
+  return name;
+}
+
+Collisions findCollisions() {
+  const int CANDIDATES = 1 << 18;
+  const NameTableHash HOME_MASK = (1 << 12) - 1;
+
+  mt19937_64 engine(12345);
+  Collisions result;
+  unordered_map<NameTableHash, string> seen;
+  seen.reserve(CANDIDATES);
+  for (int k = 0; k < CANDIDATES; k++) {
+    string name = "c" + randomName(engine, 9);
+    NameTableHash hash = hash_identifier(name);
+    auto inserted = seen.emplace(hash, name);
+    if (!inserted.second && inserted.first->second != name)
+      result.fullPairs.emplace_back(inserted.first->second, name);
+    if ((hash & HOME_MASK) == 0 && result.sameHome.size() < 64)
+      result.sameHome.push_back(name);
+  }
+  return result;
+}
+
+class StreamBuilder {
+public:
+  StreamBuilder(unsigned long long seed, const Collisions &collisions)
+      : m_engine(seed), m_collisions(collisions), m_depth(0) {}
+
+  vector<WorkloadCommand> build(int nlines);
+
+private:
+  bool trueWithProb(double p) {
+    uniform_real_distribution<> distro(0, 1);
+    return distro(m_engine) < p;
+  }
+
+  int randInt(int n) {
+    uniform_int_distribution<> distro(0, n - 1);
+    return distro(m_engine);
+  }
+
+  const string &pick(const vector<string> &ids) {
+    return ids[randInt(static_cast<int>(ids.size()))];
+  }
+
+  void enter() {
+    push(WorkloadCommand::ENTER_SCOPE, "");
+    m_depth++;
+  }
+
+  void exit() {
+    push(WorkloadCommand::EXIT_SCOPE, "");
+    if (m_depth > 0)
+      m_depth--;
+  }
+
+  void declare(const string &id) {
+    m_ids.push_back(id);
+    push(WorkloadCommand::DECLARE, id);
+  }
+
+  void find(const string &id) { push(WorkloadCommand::FIND, id); }
+
+  void push(WorkloadCommand::Kind kind, const string &id) {
+    m_commands.push_back(
+        WorkloadCommand{kind, id, static_cast<int>(m_commands.size()) + 1});
+  }
+
+  void generated(int nlines);
+  void collisions(int nlines);
+  void deepNesting(int nlines);
+  void massShadowing(int nlines);
+  void longIdentifiers(int nlines);
+  void scopeChurn(int nlines);
+  void globalExits();
+
+  mt19937_64 m_engine;
+  const Collisions &m_collisions;
+  vector<WorkloadCommand> m_commands;
+  vector<string> m_ids; // Every identifier declared so far
+  int m_depth;
+};
+
+vector<WorkloadCommand> StreamBuilder::build(int nlines) {
+  int target = max(1, nlines / 2 + randInt(nlines / 2 + 1));
+  while (static_cast<int>(m_commands.size()) < target) {
+    int stretch = 1 + randInt(max(1, target / 4));
+    switch (randInt(8)) {
+    case 0:
+    case 1:
+      generated(stretch);
+      break;
+    case 2:
+      collisions(stretch);
+      break;
+    case 3:
+      deepNesting(stretch);
+      break;
+    case 4:
+      massShadowing(stretch);
+      break;
+    case 5:
+      longIdentifiers(stretch);
+      break;
+    case 6:
+      scopeChurn(stretch);
+      break;
+    case 7:
+      globalExits();
+      break;
+    }
+  }
+  return m_commands;
+}
+
+// A stretch from generateTests.cpp's generator with random knobs, with its
+// line numbers moved to where it lands in the stream
+void StreamBuilder::generated(int nlines) {
+  WorkloadOptions options;
+  uniform_real_distribution<> unit(0, 1);
+  options.probScopeChange = unit(m_engine) * 0.5;
+  options.enterBias = 0.3 + unit(m_engine) * 0.4;
+  options.probDeclareVsUse = unit(m_engine);
+  options.probUndeclared = unit(m_engine) * 0.2;
+  options.probDupDeclare = unit(m_engine) * 0.3;
+  options.probDefaultIdLen = unit(m_engine);
+  options.defaultIdLen = 1 + randInt(8);
+  options.maxIdLen = 1 + randInt(40);
+
+  WorkloadGenerator generator(m_engine(), options);
+  for (const WorkloadCommand &cmd : generator.generate(nlines)) {
+    switch (cmd.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+      enter();
+      break;
+    case WorkloadCommand::EXIT_SCOPE:
+      exit();
+      break;
+    case WorkloadCommand::DECLARE:
+      declare(cmd.id);
+      break;
+    case WorkloadCommand::FIND:
+      find(cmd.id);
+      break;
+    }
+  }
+}
+
+void StreamBuilder::collisions(int nlines) {
+  vector<string> ids = m_collisions.sameHome;
+  for (const pair<string, string> &collision : m_collisions.fullPairs) {
+    ids.push_back(collision.first);
+    ids.push_back(collision.second);
+  }
+  if (ids.empty())
+    return;
+  for (int k = 0; k < nlines; k++) {
+    int r = randInt(10);
+    if (r < 4)
+      declare(pick(ids));
+    else if (r < 8)
+      find(pick(ids));
+    else if (r == 8)
+      enter();
+    else
+      exit();
+  }
+}
+
+void StreamBuilder::deepNesting(int nlines) {
+  int levels = 1 + randInt(max(1, nlines / 2));
+  for (int level = 0; level < levels; level++) {
+    enter();
+    if (trueWithProb(0.3))
+      declare(randomName(m_engine, 1 + randInt(3)));
+    if (!m_ids.empty() && trueWithProb(0.3))
+      find(pick(m_ids));
+  }
+  for (int level = 0; level < levels; level++) {
+    if (!m_ids.empty() && trueWithProb(0.3))
+      find(pick(m_ids));
+    exit();
+  }
+}
+
+// One identifier, or a handful, declared at every level, with lookups on the
+// way down and on the way back up through the shadowed declarations
+void StreamBuilder::massShadowing(int nlines) {
+  vector<string> ids;
+  int count = 1 + randInt(4);
+  for (int k = 0; k < count; k++)
+    ids.push_back(m_ids.empty() || trueWithProb(0.5)
+                      ? randomName(m_engine, 1 + randInt(6))
+                      : pick(m_ids));
+  int levels = 1 + randInt(max(1, nlines / 4));
+  for (int level = 0; level < levels; level++) {
+    enter();
+    for (const string &id : ids) {
+      declare(id);
+      if (trueWithProb(0.1))
+        declare(id); // A duplicate in the same scope
+    }
+    if (trueWithProb(0.2))
+      find(pick(ids));
+  }
+  for (int level = 0; level < levels; level++) {
+    exit();
+    find(pick(ids));
+  }
+}
+
+// Identifiers around and well past the 20 characters NameTable stores in
+// place, sharing long prefixes, and prefixes of one another
+void StreamBuilder::longIdentifiers(int nlines) {
+  string stem = randomName(m_engine, 16 + randInt(30));
+  vector<string> ids;
+  for (int k = 0; k < 8; k++) {
+    int len = 1 + randInt(static_cast<int>(stem.size()));
+    string id = stem.substr(0, len);
+    if (trueWithProb(0.5))
+      id += randomName(m_engine, 1 + randInt(4));
+    ids.push_back(id);
+  }
+  for (int k = 0; k < nlines; k++) {
+    int r = randInt(10);
+    if (r < 4)
+      declare(pick(ids));
+    else if (r < 8)
+      find(pick(ids));
+    else if (r == 8)
+      enter();
+    else
+      exit();
+  }
+}
+
+// Many short scopes, so that space freed by closing one is reused by the next
+// while dead declarations may still be linked from their symbols
+void StreamBuilder::scopeChurn(int nlines) {
+  vector<string> ids;
+  for (int k = 0; k < 16; k++)
+    ids.push_back(m_ids.empty() || trueWithProb(0.5)
+                      ? randomName(m_engine, 1 + randInt(4))
+                      : pick(m_ids));
+  while (nlines > 0) {
+    enter();
+    int declarations = randInt(12);
+    for (int k = 0; k < declarations; k++)
+      declare(pick(ids));
+    exit();
+    find(pick(ids));
+    nlines -= declarations + 3;
+  }
+}
+
+void StreamBuilder::globalExits() {
+  while (m_depth > 0)
+    exit();
+  int count = 1 + randInt(3);
+  for (int k = 0; k < count; k++) {
+    exit();
+    if (!m_ids.empty())
+      find(pick(m_ids));
+  }
+}
+
+//========================================================================
+// Minimization
+//========================================================================
+
+// Delta debugging: repeatedly try dropping one of n chunks of the stream,
+// keeping any smaller stream on which the target still fails, until no
+// single command can be dropped
+vector<WorkloadCommand> minimize(vector<WorkloadCommand> commands,
+                                 const Target &target) {
+  long long mismatch = target.check(commands);
+  commands.resize(mismatch + 1);
+
+  size_t chunks = 2;
+  while (commands.size() >= 2) {
+    size_t chunkSize = (commands.size() + chunks - 1) / chunks;
+    bool reduced = false;
+    for (size_t start = 0; start < commands.size(); start += chunkSize) {
+      vector<WorkloadCommand> candidate(commands.begin(),
+                                        commands.begin() + start);
+      candidate.insert(candidate.end(),
+                       commands.begin() +
+                           min(start + chunkSize, commands.size()),
+                       commands.end());
+      mismatch = target.check(candidate);
+      if (mismatch != -1) {
+        candidate.resize(mismatch + 1);
+        commands = candidate;
+        chunks = max<size_t>(chunks - 1, 2);
+        reduced = true;
+        break;
+      }
+    }
+    if (!reduced) {
+      if (chunks >= commands.size())
+        break;
+      chunks = min(chunks * 2, commands.size());
+    }
+  }
+  return commands;
+}
+
+bool writeStream(const string &path, const vector<WorkloadCommand> &commands) {
+  ofstream outf(path);
+  if (!outf)
+    return false;
+  for (const WorkloadCommand &cmd : commands)
+    writeCommand(outf, cmd);
+  return true;
+}
+
+//========================================================================
+
+bool parseOption(const string &arg, const string &name, string &value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+int replay(const string &path) {
+  ifstream dataf(path);
+  if (!dataf) {
+    cerr << "Cannot open " << path << endl;
+    return 2;
+  }
+  vector<WorkloadCommand> commands = readWorkload(dataf);
+  int status = 0;
+  for (const Target &target : TARGETS) {
+    long long mismatch = target.check(commands);
+    cout << target.name << ": ";
+    if (mismatch == -1)
+      cout << "Passed" << endl;
+    else {
+      cout << "*** FAILED *** at command " << mismatch + 1 << endl;
+      status = 1;
+    }
+  }
+  return status;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long long seed = 1;
+  long long iterations = 1000;
+  double seconds = -1;
+  int nlines = 4000;
+  string outPath = "fuzz-failure.txt";
+
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    string value;
+    if (parseOption(arg, "seed", value))
+      seed = strtoull(value.c_str(), nullptr, 10);
+    else if (parseOption(arg, "iterations", value))
+      iterations = atoll(value.c_str());
+    else if (parseOption(arg, "seconds", value))
+      seconds = atof(value.c_str());
+    else if (parseOption(arg, "lines", value))
+      nlines = atoi(value.c_str());
+    else if (parseOption(arg, "out", value))
+      outPath = value;
+    else if (parseOption(arg, "replay", value))
+      return replay(value);
+    else {
+      cerr << "Unknown option " << arg << endl;
+      return 2;
+    }
+  }
+  if (nlines < 1)
+    nlines = 1;
+
+  Collisions collisions = findCollisions();
+  cout << "Found " << collisions.fullPairs.size()
+       << " pairs of identifiers with equal hashes" << endl;
+
+  using Clock = chrono::steady_clock;
+  Clock::time_point begin = Clock::now();
+  long long commandsRun = 0;
+  long long k = 0;
+  for (; iterations == 0 || k < iterations; k++) {
+    if (seconds >= 0 &&
+        chrono::duration<double>(Clock::now() - begin).count() >= seconds)
+      break;
+
+    StreamBuilder builder(seed + k, collisions);
+    vector<WorkloadCommand> commands = builder.build(nlines);
+    commandsRun += commands.size();
+    for (const Target &target : TARGETS) {
+      if (target.check(commands) == -1)
+        continue;
+
+      cout << target.name << " disagrees with SlowNameTable on the stream "
+           << "from seed " << seed + k << " (" << commands.size()
+           << " commands)" << endl;
+      vector<WorkloadCommand> small = minimize(commands, target);
+      cout << "Minimized to " << small.size() << " commands";
+      if (writeStream(outPath, small))
+        cout << ", written to " << outPath;
+      cout << endl;
+      return 1;
+    }
+
+    if ((k + 1) % 100 == 0)
+      cout << k + 1 << " streams, " << commandsRun << " commands" << endl;
+  }
+  cout << "Passed: " << k << " streams, " << commandsRun << " commands" << endl;
+}
@@ -0,0 +1,454 @@
+// Usage:  replayAll DIRECTORY|MANIFEST [--threads=N] [--no-check]
+//
+// Replay many independent command logs, one per translation unit, each on its
+// own NameTable.  The argument is either a directory, every regular file of
+// which is a log, or a manifest file listing one log path per line (relative
+// paths are taken relative to the manifest; blank lines and lines starting
+// with # are ignored).  A log may be a commands.txt text file or a binary log
+// written by convertCommands (see CommandLog.h); binary logs are recognized
+// by their magic number.
+//
+// The logs are spread over a pool of worker threads (one per hardware thread
+// unless --threads says otherwise).  Each worker has its own deque of logs,
+// takes work from its back, and when it runs dry steals from the front of
+// another worker's deque, so a few huge logs do not leave the other workers
+// idle.  Unless --no-check is given, each log is replayed a second time
+// against SlowNameTable and every result compared.  The exit status is
+// nonzero if any log could not be read or disagreed.
+
+#include "CommandLog.h"
+#include "NameTable.h"
+#include "SlowNameTable.h"
+#include "Workload.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+using namespace std;
+namespace fs = std::filesystem;
+
+using Clock = chrono::steady_clock;
+
+struct LogResult {
+  string path;
+  bool readable = false;
+  long long commands = 0;
+  double replayMs = 0;       // NameTable replay only, not loading or checking
+  string check = "Skipped";  // "Passed", "Skipped", or the first disagreement
+};
+
+//========================================================================
+// Replaying one log
+//========================================================================
+
+// Each kind of log is loaded into a form the replay loops can walk without
+// further parsing, so that the timed replay measures only NameTable.
+struct TextLog {
+  vector<WorkloadCommand> commands;
+};
+
+struct BinaryLog {
+  MappedFile file;
+  CommandLogView view;
+  vector<string> ids;
+};
+
+long long replayText(const TextLog &log, NameTable &nt) {
+  for (const WorkloadCommand &cmd : log.commands) {
+    switch (cmd.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+      nt.enterScope();
+      break;
+    case WorkloadCommand::EXIT_SCOPE:
+      nt.exitScope();
+      break;
+    case WorkloadCommand::DECLARE:
+      nt.declare(cmd.id, cmd.lineNum);
+      break;
+    case WorkloadCommand::FIND:
+      nt.find(cmd.id);
+      break;
+    }
+  }
+  return static_cast<long long>(log.commands.size());
+}
+
+string checkText(const TextLog &log) {
+  NameTable nt;
+  SlowNameTable snt;
+  for (size_t k = 0; k < log.commands.size(); k++) {
+    const WorkloadCommand &cmd = log.commands[k];
+    bool agree = true;
+    switch (cmd.kind) {
+    case WorkloadCommand::ENTER_SCOPE:
+      nt.enterScope();
+      snt.enterScope();
+      break;
+    case WorkloadCommand::EXIT_SCOPE:
+      agree = nt.exitScope() == snt.exitScope();
+      break;
+    case WorkloadCommand::DECLARE:
+      agree = nt.declare(cmd.id, cmd.lineNum) == snt.declare(cmd.id, cmd.lineNum);
+      break;
+    case WorkloadCommand::FIND:
+      agree = nt.find(cmd.id) == snt.find(cmd.id);
+      break;
+    }
+    if (!agree)
+      return "*** FAILED *** at command " + to_string(k + 1);
+  }
+  return "Passed";
+}
+
+// Returns the number of commands replayed, or -1 if the words are malformed
+long long replayBinary(const BinaryLog &log, NameTable &nt) {
+  vector<SymbolId> symbols;
+  symbols.reserve(log.ids.size());
+  for (const string &id : log.ids)
+    symbols.push_back(nt.intern(id));
+
+  const uint32_t *word = log.view.words();
+  const uint32_t *end = word + log.view.wordCount();
+  long long ncommands = 0;
+  while (word != end) {
+    uint32_t command = *word++;
+    uint32_t symbol = command >> OPCODE_BITS;
+    switch (command & OPCODE_MASK) {
+    case OP_ENTER_SCOPE:
+      nt.enterScope();
+      break;
+    case OP_EXIT_SCOPE:
+      nt.exitScope();
+      break;
+    case OP_DECLARE:
+      if (word == end || symbol >= symbols.size())
+        return -1;
+      nt.declare(symbols[symbol], static_cast<int>(*word++));
+      break;
+    case OP_FIND:
+      if (symbol >= symbols.size())
+        return -1;
+      nt.find(symbols[symbol]);
+      break;
+    }
+    ncommands++;
+  }
+  return ncommands;
+}
+
+string checkBinary(const BinaryLog &log) {
+  NameTable nt;
+  SlowNameTable snt;
+  vector<SymbolId> symbols;
+  for (const string &id : log.ids)
+    symbols.push_back(nt.intern(id));
+
+  const uint32_t *begin = log.view.words();
+  const uint32_t *word = begin;
+  const uint32_t *end = word + log.view.wordCount();
+  while (word != end) {
+    long long offset = word - begin;
+    uint32_t command = *word++;
+    uint32_t symbol = command >> OPCODE_BITS;
+    bool agree = true;
+    switch (command & OPCODE_MASK) {
+    case OP_ENTER_SCOPE:
+      nt.enterScope();
+      snt.enterScope();
+      break;
+    case OP_EXIT_SCOPE:
+      agree = nt.exitScope() == snt.exitScope();
+      break;
+    case OP_DECLARE: {
+      // replayBinary has already rejected malformed words
+      int lineNum = static_cast<int>(*word++);
+      agree = nt.declare(symbols[symbol], lineNum) ==
+              snt.declare(log.ids[symbol], lineNum);
+      break;
+    }
+    case OP_FIND:
+      agree = nt.find(symbols[symbol]) == snt.find(log.ids[symbol]);
+      break;
+    }
+    if (!agree)
+      return "*** FAILED *** at word " + to_string(offset);
+  }
+  return "Passed";
+}
+
+bool isBinaryLog(const string &path) {
+  ifstream inf(path, ios::binary);
+  char magic[sizeof(COMMAND_LOG_MAGIC)];
+  return inf.read(magic, sizeof(magic)) &&
+         memcmp(magic, COMMAND_LOG_MAGIC, sizeof(magic)) == 0;
+}
+
+LogResult runLog(const string &path, bool check) {
+  LogResult result;
+  result.path = path;
+
+  if (isBinaryLog(path)) {
+    BinaryLog log;
+    if (!log.file.open(path) ||
+        !log.view.open(log.file.data(), log.file.size()) ||
+        !log.view.forEachId(
+            [&](uint32_t, string_view id) { log.ids.emplace_back(id); }))
+      return result;
+
+    NameTable nt;
+    Clock::time_point start = Clock::now();
+    result.commands = replayBinary(log, nt);
+    result.replayMs =
+        chrono::duration<double, milli>(Clock::now() - start).count();
+    if (result.commands < 0) {
+      result.commands = 0;
+      return result;
+    }
+    result.readable = true;
+    if (check)
+      result.check = checkBinary(log);
+  } else {
+    ifstream inf(path);
+    if (!inf)
+      return result;
+    TextLog log;
+    log.commands = readWorkload(inf);
+
+    NameTable nt;
+    Clock::time_point start = Clock::now();
+    result.commands = replayText(log, nt);
+    result.replayMs =
+        chrono::duration<double, milli>(Clock::now() - start).count();
+    result.readable = true;
+    if (check)
+      result.check = checkText(log);
+  }
+  return result;
+}
+
+//========================================================================
+// Work-stealing pool
+//========================================================================
+
+struct WorkerQueue {
+  mutex lock;
+  deque<size_t> jobs; // Indexes into the list of logs
+};
+
+struct WorkerStats {
+  long long jobs = 0;
+  long long steals = 0;
+  double busyMs = 0;
+};
+
+class ReplayPool {
+public:
+  ReplayPool(const vector<string> &paths, int nthreads, bool check)
+      : m_paths(paths), m_queues(nthreads), m_stats(nthreads),
+        m_results(paths.size()), m_check(check) {
+    // Deal the logs out largest first, so that each worker starts on big
+    // ones and the small ones are left to even things out at the end
+    vector<pair<uintmax_t, size_t>> bySize;
+    for (size_t k = 0; k < paths.size(); k++) {
+      error_code ec;
+      uintmax_t size = fs::file_size(paths[k], ec);
+      bySize.emplace_back(ec ? 0 : size, k);
+    }
+    sort(bySize.begin(), bySize.end(),
+         [](const pair<uintmax_t, size_t> &a, const pair<uintmax_t, size_t> &b) {
+           return a.first > b.first;
+         });
+    for (size_t k = 0; k < bySize.size(); k++)
+      m_queues[k % nthreads].jobs.push_front(bySize[k].second);
+  }
+
+  void run() {
+    vector<thread> threads;
+    for (size_t w = 0; w < m_queues.size(); w++)
+      threads.emplace_back(&ReplayPool::work, this, w);
+    for (thread &t : threads)
+      t.join();
+  }
+
+  const vector<LogResult> &results() const { return m_results; }
+  const vector<WorkerStats> &stats() const { return m_stats; }
+
+private:
+  void work(size_t self) {
+    WorkerStats &stats = m_stats[self];
+    size_t job;
+    while (takeJob(self, job, stats)) {
+      Clock::time_point start = Clock::now();
+      m_results[job] = runLog(m_paths[job], m_check);
+      stats.busyMs +=
+          chrono::duration<double, milli>(Clock::now() - start).count();
+      stats.jobs++;
+    }
+  }
+
+  // Take the next job from our own deque, or steal the oldest job from
+  // another worker's.  No new jobs ever appear, so once every deque has been
+  // seen empty there is nothing left to do.
+  bool takeJob(size_t self, size_t &job, WorkerStats &stats) {
+    {
+      WorkerQueue &own = m_queues[self];
+      lock_guard<mutex> guard(own.lock);
+      if (!own.jobs.empty()) {
+        job = own.jobs.back();
+        own.jobs.pop_back();
+        return true;
+      }
+    }
+    for (size_t k = 1; k < m_queues.size(); k++) {
+      WorkerQueue &victim = m_queues[(self + k) % m_queues.size()];
+      lock_guard<mutex> guard(victim.lock);
+      if (!victim.jobs.empty()) {
+        job = victim.jobs.front();
+        victim.jobs.pop_front();
+        stats.steals++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const vector<string> &m_paths;
+  vector<WorkerQueue> m_queues;
+  vector<WorkerStats> m_stats;
+  vector<LogResult> m_results;
+  bool m_check;
+};
+
+//========================================================================
+// Finding the logs
+//========================================================================
+
+bool listLogs(const string &arg, vector<string> &paths) {
+  error_code ec;
+  if (fs::is_directory(arg, ec)) {
+    for (const fs::directory_entry &entry : fs::directory_iterator(arg, ec)) {
+      if (entry.is_regular_file(ec))
+        paths.push_back(entry.path().string());
+    }
+    sort(paths.begin(), paths.end());
+    return !ec;
+  }
+
+  ifstream manifest(arg);
+  if (!manifest)
+    return false;
+  fs::path base = fs::path(arg).parent_path();
+  string line;
+  while (getline(manifest, line)) {
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == string::npos || line[first] == '#')
+      continue;
+    size_t last = line.find_last_not_of(" \t\r");
+    fs::path path = line.substr(first, last - first + 1);
+    paths.push_back((path.is_absolute() ? path : base / path).string());
+  }
+  return true;
+}
+
+bool parseOption(const string &arg, const string &name, string &value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  string source;
+  int nthreads = static_cast<int>(thread::hardware_concurrency());
+  bool check = true;
+
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    string value;
+    if (parseOption(arg, "threads", value))
+      nthreads = atoi(value.c_str());
+    else if (arg == "--no-check")
+      check = false;
+    else if (source.empty() && arg.compare(0, 2, "--") != 0)
+      source = arg;
+    else {
+      cerr << "Usage: " << argv[0]
+           << " DIRECTORY|MANIFEST [--threads=N] [--no-check]" << endl;
+      return 2;
+    }
+  }
+  if (source.empty()) {
+    cerr << "Usage: " << argv[0]
+         << " DIRECTORY|MANIFEST [--threads=N] [--no-check]" << endl;
+    return 2;
+  }
+  if (nthreads < 1)
+    nthreads = 1;
+
+  vector<string> paths;
+  if (!listLogs(source, paths)) {
+    cerr << "Cannot read " << source << endl;
+    return 2;
+  }
+
+  Clock::time_point start = Clock::now();
+  ReplayPool pool(paths, nthreads, check);
+  pool.run();
+  double wallMs = chrono::duration<double, milli>(Clock::now() - start).count();
+
+  long long totalCommands = 0;
+  double totalReplayMs = 0;
+  int unreadable = 0;
+  int mismatched = 0;
+  for (const LogResult &result : pool.results()) {
+    if (!result.readable) {
+      unreadable++;
+      cout << "Cannot read command log " << result.path << endl;
+      continue;
+    }
+    totalCommands += result.commands;
+    totalReplayMs += result.replayMs;
+    if (result.check != "Passed" && result.check != "Skipped") {
+      mismatched++;
+      cout << result.path << ": " << result.check << endl;
+    }
+  }
+
+  long long steals = 0;
+  double busyMs = 0;
+  for (const WorkerStats &stats : pool.stats()) {
+    steals += stats.steals;
+    busyMs += stats.busyMs;
+  }
+
+  cout << "Replayed " << paths.size() - unreadable << " logs ("
+       << totalCommands << " commands) on " << nthreads << " threads" << endl
+       << "   Wall time: " << wallMs << " msec." << endl
+       << "   NameTable replay: " << totalReplayMs << " msec. total, "
+       << (totalReplayMs > 0 ? totalCommands / totalReplayMs / 1000 : 0)
+       << " Mcommands/s per thread" << endl
+       << "   Worker utilization: "
+       << (wallMs > 0 ? 100 * busyMs / (wallMs * nthreads) : 0) << "%, "
+       << steals << " steals" << endl;
+  if (check)
+    cout << "Correctness check: "
+         << (mismatched == 0 ? "Passed"
+                             : to_string(mismatched) + " logs *** FAILED ***")
+         << endl;
+  if (unreadable > 0)
+    cout << unreadable << " logs could not be read" << endl;
+
+  return unreadable == 0 && mismatched == 0 ? 0 : 1;
+}
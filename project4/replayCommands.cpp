@@ -0,0 +1,151 @@
+// Usage:  replayCommands log.bin [--check]
+//
+// Memory-map a binary command log (see CommandLog.h) and run it against a
+// NameTable.  Identifiers are interned once up front, so the replay loop only
+// decodes words and calls the SymbolId overloads: no per-command allocation,
+// parsing or virtual dispatch.  With --check, the log is also run against
+// SlowNameTable and every result is compared.
+
+#include "CommandLog.h"
+#include "NameTable.h"
+#include "SlowNameTable.h"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+// Returns the number of commands replayed, or -1 if the log is malformed
+long long replay(const CommandLogView &log, NameTable &nt,
+                 const vector<SymbolId> &symbols) {
+  const uint32_t *word = log.words();
+  const uint32_t *end = word + log.wordCount();
+  long long ncommands = 0;
+  while (word != end) {
+    uint32_t command = *word++;
+    uint32_t symbol = command >> OPCODE_BITS;
+    switch (command & OPCODE_MASK) {
+    case OP_ENTER_SCOPE:
+      nt.enterScope();
+      break;
+    case OP_EXIT_SCOPE:
+      nt.exitScope();
+      break;
+    case OP_DECLARE:
+      if (word == end || symbol >= symbols.size())
+        return -1;
+      nt.declare(symbols[symbol], static_cast<int>(*word++));
+      break;
+    case OP_FIND:
+      if (symbol >= symbols.size())
+        return -1;
+      nt.find(symbols[symbol]);
+      break;
+    }
+    ncommands++;
+  }
+  return ncommands;
+}
+
+// Returns "Passed", or a description of the first disagreement
+string replayAndCheck(const CommandLogView &log, NameTable &nt,
+                      const vector<SymbolId> &symbols, SlowNameTable &snt,
+                      const vector<string> &ids) {
+  const uint32_t *begin = log.words();
+  const uint32_t *word = begin;
+  const uint32_t *end = word + log.wordCount();
+  while (word != end) {
+    long long offset = word - begin;
+    uint32_t command = *word++;
+    uint32_t symbol = command >> OPCODE_BITS;
+    bool agree = true;
+    switch (command & OPCODE_MASK) {
+    case OP_ENTER_SCOPE:
+      nt.enterScope();
+      snt.enterScope();
+      break;
+    case OP_EXIT_SCOPE:
+      agree = nt.exitScope() == snt.exitScope();
+      break;
+    case OP_DECLARE: {
+      if (word == end || symbol >= symbols.size())
+        return "*** MALFORMED *** at word " + to_string(offset);
+      int lineNum = static_cast<int>(*word++);
+      agree = nt.declare(symbols[symbol], lineNum) ==
+              snt.declare(ids[symbol], lineNum);
+      break;
+    }
+    case OP_FIND:
+      if (symbol >= symbols.size())
+        return "*** MALFORMED *** at word " + to_string(offset);
+      agree = nt.find(symbols[symbol]) == snt.find(ids[symbol]);
+      break;
+    }
+    if (!agree)
+      return "*** FAILED *** at word " + to_string(offset);
+  }
+  return "Passed";
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3 || (argc == 3 && string(argv[2]) != "--check")) {
+    cerr << "Usage: " << argv[0] << " log.bin [--check]" << endl;
+    return 2;
+  }
+
+  MappedFile file;
+  CommandLogView log;
+  if (!file.open(argv[1]) || !log.open(file.data(), file.size())) {
+    cerr << "Cannot read command log " << argv[1] << endl;
+    return 1;
+  }
+
+  using Clock = chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+
+  NameTable nt;
+  vector<SymbolId> symbols;
+  symbols.reserve(log.idCount());
+  bool wellFormed = log.forEachId([&](uint32_t, string_view id) {
+    symbols.push_back(nt.intern(id));
+  });
+  if (!wellFormed) {
+    cerr << "Malformed identifier table in " << argv[1] << endl;
+    return 1;
+  }
+
+  Clock::time_point interned = Clock::now();
+  long long ncommands = replay(log, nt, symbols);
+  Clock::time_point replayed = Clock::now();
+
+  if (ncommands < 0) {
+    cerr << "Malformed command words in " << argv[1] << endl;
+    return 1;
+  }
+
+  cout << "Replayed " << ncommands << " commands ("
+       << log.idCount() << " distinct identifiers)" << endl
+       << "   Interning: "
+       << chrono::duration<double, milli>(interned - start).count()
+       << " msec." << endl
+       << "      Replay: "
+       << chrono::duration<double, milli>(replayed - interned).count()
+       << " msec." << endl;
+
+  if (argc == 3) {
+    NameTable checkNt;
+    SlowNameTable snt;
+    vector<SymbolId> checkSymbols;
+    vector<string> ids;
+    log.forEachId([&](uint32_t, string_view id) {
+      checkSymbols.push_back(checkNt.intern(id));
+      ids.emplace_back(id);
+    });
+    string result = replayAndCheck(log, checkNt, checkSymbols, snt, ids);
+    cout << "Correctness check: " << result << endl;
+    if (result != "Passed")
+      return 1;
+  }
+}
@@ -7,28 +7,19 @@
 //   identifier           which requests a call to find(identifier)
 
 #include "NameTable.h"
+#include "SlowNameTable.h"
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
 const char *COMMAND_FILE_NAME = "project4/commands.txt";
 
-class SlowNameTable {
-public:
-  void enterScope();
-  bool exitScope();
-  bool declare(const string &id, int lineNum);
-  int find(const string &id) const;
-
-private:
-  vector<string> m_ids;
-  vector<int> m_lines;
-};
-
 struct Command {
   static Command *create(string line, int lineno);
   Command(string line, int lineno) : m_line(line), m_lineno(lineno) {}
@@ -40,7 +31,12 @@ struct Command {
 };
 
 void extractCommands(istream &dataf, vector<Command *> &commands);
-string testCorrectness(const vector<Command *> &commands);
+string testCorrectness(const vector<Command *> &commands,
+                       size_t filterCounters = 0);
+string testSymbolOverloads();
+string testStats();
+string testSnapshots(const vector<Command *> &commands);
+string testBatches(const vector<Command *> &commands, size_t filterCounters);
 void testPerformance(const vector<Command *> &commands);
 
 int main() {
@@ -102,6 +98,12 @@ int main() {
     delete commands[k];
   commands.clear();
 
+  cout << "Symbol and string_view overload test: " << flush;
+  cout << testSymbolOverloads() << endl;
+
+  cout << "Statistics test: " << flush;
+  cout << testStats() << endl;
+
   // Thorough correctness and performance tests
 
   ifstream thoroughf(COMMAND_FILE_NAME);
@@ -115,6 +117,20 @@ int main() {
   cout << "Thorough correctness test: " << flush;
   cout << testCorrectness(commands) << endl;
 
+  // A deliberately small filter, so that counters are shared and saturate
+
+  cout << "Thorough correctness test with negative filter: " << flush;
+  cout << testCorrectness(commands, 256) << endl;
+
+  cout << "Snapshot and restore test: " << flush;
+  cout << testSnapshots(commands) << endl;
+
+  cout << "Batch test: " << flush;
+  cout << testBatches(commands, 0) << endl;
+
+  cout << "Batch test with negative filter: " << flush;
+  cout << testBatches(commands, 256) << endl;
+
   cout << "Performance test on " << commands.size() << " commands: " << flush;
   testPerformance(commands);
 
@@ -187,8 +203,11 @@ void extractCommands(istream &dataf, vector<Command *> &commands) {
   }
 }
 
-string testCorrectness(const vector<Command *> &commands) {
+string testCorrectness(const vector<Command *> &commands,
+                       size_t filterCounters) {
   NameTable nt;
+  if (filterCounters > 0)
+    nt.enableNegativeFilter(filterCounters);
   SlowNameTable snt;
   for (size_t k = 0; k < commands.size(); k++) {
     // Check if command agrees with our behavior
@@ -203,6 +222,228 @@ string testCorrectness(const vector<Command *> &commands) {
   return "Passed";
 }
 
+string testSymbolOverloads() {
+  NameTable nt;
+  char buffer[] = "alpha beta";
+  string_view alpha(buffer, 5);
+
+  SymbolId a = nt.intern(alpha);
+  if (a < 0 || nt.intern("alpha") != a || nt.intern("") != -1)
+    return "*** FAILED *** intern";
+  if (nt.find(a) != -1 || !nt.declare(a, 1) || nt.declare("alpha", 2))
+    return "*** FAILED *** declare by SymbolId";
+  if (nt.find(string("alpha")) != 1 || nt.find(alpha) != 1 || nt.find(a) != 1)
+    return "*** FAILED *** find after declare by SymbolId";
+
+  nt.enterScope();
+  if (!nt.declare(string_view(buffer + 6, 4), 3) || nt.find("beta") != 3)
+    return "*** FAILED *** declare by string_view";
+  if (!nt.declare(alpha, 4) || nt.find(a) != 4)
+    return "*** FAILED *** shadowing by string_view";
+  nt.exitScope();
+
+  if (nt.find(a) != 1 || nt.find("beta") != -1)
+    return "*** FAILED *** find after exitScope";
+  if (nt.declare(SymbolId(1000), 5) || nt.find(SymbolId(1000)) != -1 ||
+      nt.find(SymbolId(-1)) != -1)
+    return "*** FAILED *** invalid SymbolId";
+  return "Passed";
+}
+
+string testStats() {
+  NameTable nt;
+  nt.declare("alpha", 1);
+  nt.declare("beta", 2);
+  nt.enterScope();
+  nt.declare("alpha", 3);
+  nt.declare("alpha", 4);
+  nt.enterScope();
+  nt.declare("alpha", 5);
+  nt.find("alpha");
+  nt.find("gamma");
+
+  NameTableStats s = nt.stats();
+  if (s.liveDeclarations != 4 || s.scopeDepth != 2 || s.symbols != 2)
+    return "*** FAILED *** declarations, scopes or symbols";
+  if (s.maxShadowDepth != 3)
+    return "*** FAILED *** maxShadowDepth";
+  long long histogramTotal = 0;
+  for (long long count : s.probeLengths)
+    histogramTotal += count;
+  // Indexes that are not hash tables report no slots
+  if (s.slots > 0 &&
+      (histogramTotal != s.symbols ||
+       s.loadFactor != static_cast<double>(s.symbols) / s.slots))
+    return "*** FAILED *** load factor or probe lengths";
+  if (s.bytesAllocated == 0 || s.peakBytesAllocated < s.bytesAllocated)
+    return "*** FAILED *** bytes allocated";
+
+  nt.exitScope();
+  nt.exitScope();
+  nt.exitScope();
+  if (nt.stats().maxShadowDepth != 1)
+    return "*** FAILED *** maxShadowDepth after exitScope";
+
+  // A few thousand symbols make the hash table grow several times
+  size_t before = s.bytesAllocated;
+  for (int k = 0; k < 5000; k++)
+    nt.declare("id" + to_string(k), k);
+  s = nt.stats();
+  if (s.bytesAllocated <= before || s.peakBytesAllocated < s.bytesAllocated ||
+      s.loadFactor > 1)
+    return "*** FAILED *** bytes allocated after growing";
+
+  if (s.countersEnabled &&
+      (s.declares != 5005 || s.declareFailures != 1 || s.finds != 2 ||
+       s.findHits != 1 || s.exitScopes != 3 || s.exitScopeFailures != 1))
+    return "*** FAILED *** operation counters";
+  return "Passed";
+}
+
+// Runs the commands while periodically taking snapshots and restoring earlier
+// ones, including ones taken on a branch that a restore has since abandoned.
+// SlowNameTable is copyable, so a copy of it serves as the expected state.
+//
+// After a restore the commands no longer match the scope depth they were
+// generated for, so a "}" may arrive with no scope open.  SlowNameTable
+// discards global declarations in that case, so such commands are skipped.
+string testSnapshots(const vector<Command *> &commands) {
+  const size_t SNAPSHOT_EVERY = 1000;
+  const size_t RESTORE_EVERY = 1500;
+
+  NameTable nt;
+  SlowNameTable snt;
+  vector<NameTableSnapshot> snapshots;
+  vector<SlowNameTable> expected;
+  vector<int> expectedDepth;
+  int depth = 0;
+
+  NameTable other;
+  if (nt.restore(other.snapshot()) || nt.restore(NameTableSnapshot()))
+    return "*** FAILED *** restored a snapshot of another table";
+
+  for (size_t k = 0; k < commands.size(); k++) {
+    if (k % SNAPSHOT_EVERY == 0) {
+      snapshots.push_back(nt.snapshot());
+      expected.push_back(snt);
+      expectedDepth.push_back(depth);
+    } else if (k % RESTORE_EVERY == 0) {
+      size_t j = (k / RESTORE_EVERY * 7919) % snapshots.size();
+      if (!nt.restore(snapshots[j]))
+        return "*** FAILED *** restore returned false";
+      snt = expected[j];
+      depth = expectedDepth[j];
+    }
+
+    if (dynamic_cast<EnterScopeCmd *>(commands[k]) != nullptr)
+      depth++;
+    else if (dynamic_cast<ExitScopeCmd *>(commands[k]) != nullptr) {
+      if (depth == 0)
+        continue;
+      depth--;
+    }
+
+    if (!commands[k]->executeAndCheck(nt, snt)) {
+      ostringstream msg;
+      msg << "*** FAILED *** line " << commands[k]->m_lineno << ": \""
+          << commands[k]->m_line << "\"";
+      return msg.str();
+    }
+  }
+  return "Passed";
+}
+
+// Runs the commands with every stretch of consecutive declarations passed to
+// declareBatch, and every stretch of consecutive lookups to findBatch, after
+// checking the edge cases of a batch on a table of its own.
+string testBatches(const vector<Command *> &commands, size_t filterCounters) {
+  NameTable small;
+  pair<string_view, int> edgeCases[] = {
+      {"alpha", 1}, {"", 2}, {"alpha", 3}, {"beta", 4}};
+  bool declared[4];
+  small.declareBatch(edgeCases, 4, declared);
+  string_view edgeIds[] = {"beta", "", "gamma", "alpha"};
+  int lines[4];
+  small.findBatch(edgeIds, 4, lines);
+  if (!declared[0] || declared[1] || declared[2] || !declared[3] ||
+      lines[0] != 4 || lines[1] != -1 || lines[2] != -1 || lines[3] != 1)
+    return "*** FAILED *** duplicate or empty identifiers in a batch";
+  small.declareBatch(edgeCases, 0, nullptr);
+  small.findBatch(edgeIds, 0, nullptr);
+  small.enterScope();
+  small.declareBatch(edgeCases, 4);
+  if (small.find("alpha") != 1 || small.stats().liveDeclarations != 4)
+    return "*** FAILED *** batch without results";
+
+  NameTable nt;
+  if (filterCounters > 0)
+    nt.enableNegativeFilter(filterCounters);
+  SlowNameTable snt;
+  vector<pair<string_view, int>> declarations;
+  vector<bool> expectedDeclared;
+  vector<string_view> ids;
+  vector<int> expectedLines;
+  size_t k = 0;
+  while (k < commands.size()) {
+    size_t start = k;
+    declarations.clear();
+    expectedDeclared.clear();
+    for (; k < commands.size(); k++) {
+      DeclareCmd *cmd = dynamic_cast<DeclareCmd *>(commands[k]);
+      if (cmd == nullptr)
+        break;
+      declarations.emplace_back(cmd->m_id, cmd->m_lineNum);
+      expectedDeclared.push_back(snt.declare(cmd->m_id, cmd->m_lineNum));
+    }
+    if (!declarations.empty()) {
+      unique_ptr<bool[]> results(new bool[declarations.size()]);
+      nt.declareBatch(declarations.data(), declarations.size(), results.get());
+      for (size_t j = 0; j < declarations.size(); j++) {
+        if (results[j] != expectedDeclared[j]) {
+          ostringstream msg;
+          msg << "*** FAILED *** line " << commands[start + j]->m_lineno
+              << ": \"" << commands[start + j]->m_line << "\"";
+          return msg.str();
+        }
+      }
+    }
+
+    start = k;
+    ids.clear();
+    expectedLines.clear();
+    for (; k < commands.size(); k++) {
+      FindCmd *cmd = dynamic_cast<FindCmd *>(commands[k]);
+      if (cmd == nullptr)
+        break;
+      ids.push_back(cmd->m_id);
+      expectedLines.push_back(snt.find(cmd->m_id));
+    }
+    if (!ids.empty()) {
+      vector<int> results(ids.size());
+      nt.findBatch(ids.data(), ids.size(), results.data());
+      for (size_t j = 0; j < ids.size(); j++) {
+        if (results[j] != expectedLines[j]) {
+          ostringstream msg;
+          msg << "*** FAILED *** line " << commands[start + j]->m_lineno
+              << ": \"" << commands[start + j]->m_line << "\"";
+          return msg.str();
+        }
+      }
+    }
+
+    if (k < commands.size() && declarations.empty() && ids.empty()) {
+      if (!commands[k]->executeAndCheck(nt, snt)) {
+        ostringstream msg;
+        msg << "*** FAILED *** line " << commands[k]->m_lineno << ": \""
+            << commands[k]->m_line << "\"";
+        return msg.str();
+      }
+      k++;
+    }
+  }
+  return "Passed";
+}
+
 //========================================================================
 // Timer t;                 // create a timer and start it
 // t.start();               // (re)start the timer
@@ -249,68 +490,3 @@ void testPerformance(const vector<Command *> &commands) {
        << endl
        << "    Destruction: " << (end - endCommands) << " msec." << endl;
 }
-
-void SlowNameTable::enterScope() {
-  // Extend the id vector with an empty string that
-  // serves as a scope entry marker.
-
-  m_ids.push_back("");
-  m_lines.push_back(0);
-}
-
-bool SlowNameTable::exitScope() {
-  // Remove ids back to the last scope entry.
-
-  while (!m_ids.empty() && m_ids.back() != "") {
-    m_ids.pop_back();
-    m_lines.pop_back();
-  }
-  if (m_ids.empty())
-    return false;
-
-  // Remove the scope entry marker itself.
-
-  m_ids.pop_back();
-  m_lines.pop_back();
-  return true;
-}
-
-bool SlowNameTable::declare(const string &id, int lineNum) {
-  if (id.empty())
-    return false;
-
-  // Check for another declaration in the same scope.
-  // Return if found, break out if encounter the scope
-  // entry marker.
-
-  size_t k = m_ids.size();
-  while (k > 0) {
-    k--;
-    if (m_ids[k].empty())
-      break;
-    if (m_ids[k] == id)
-      return false;
-  }
-
-  // Save the declaration
-
-  m_ids.push_back(id);
-  m_lines.push_back(lineNum);
-  return true;
-}
-
-int SlowNameTable::find(const string &id) const {
-  if (id.empty())
-    return -1;
-
-  // Search back for the most recent declaration still
-  // available.
-
-  size_t k = m_ids.size();
-  while (k > 0) {
-    k--;
-    if (m_ids[k] == id)
-      return m_lines[k];
-  }
-  return -1;
-}